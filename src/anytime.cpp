@@ -0,0 +1,132 @@
+#include "anytime.h"
+#include "deadlock.h"
+#include "move_order.h"
+#include "pattern_db.h"
+
+#include <unordered_map>
+
+using namespace std;
+
+// Everything shared across the branch and bound search
+struct AnytimeSearch {
+  unordered_map<GameState, int> best_depths;  // normalized states, by the fewest moves they've been reached in
+  MoveOrdering* ordering;
+  const SolveOptions& options;
+  chrono::steady_clock::time_point deadline;
+  const SolutionCallback& on_solution;
+  vector<Move> line;            // moves from the start to the state being searched, in the order they're played
+  vector<Move> best_moves;      // the best solution so far, in reverse order
+  int bound;                    // only solutions with fewer moves than this are still searched for
+  size_t states_searched = 0;
+  bool stopped = false;
+
+  bool out_of_time() {
+    if ((options.cancel && *options.cancel) || best_depths.size() >= (size_t) options.max_states)
+      return true;
+    return (states_searched % 1024 == 0) && chrono::steady_clock::now() >= deadline;
+  }
+};
+
+static void search_below(AnytimeSearch& search, const GameState& state, int depth) {
+  // forced moves can take several moves at once, so this can be reached past the bound
+  if (depth >= search.bound)
+    return;
+
+  if (state.win()) {
+    search.best_moves.assign(search.line.rbegin(), search.line.rend());
+    search.bound = depth;
+    if (search.on_solution)
+      search.on_solution(search.best_moves);
+    return;
+  }
+
+  // every card left still needs a move to done, so there's no shorter solution below here
+  if (depth + moves_to_done(state) >= search.bound)
+    return;
+
+  if (search.stopped || (search.stopped = search.out_of_time()))
+    return;
+
+  // a state cut off by the bound can still lead to a shorter solution when it's reached in fewer moves,
+  // so states are only skipped when they've already been searched from at least as close to the start
+  GameState normalized_state = state;
+  normalized_state.normalize();
+  auto found = search.best_depths.find(normalized_state);
+  if (found != search.best_depths.end()) {
+    if (found->second <= depth)
+      return;
+    found->second = depth;
+  } else {
+    search.best_depths.emplace(normalized_state, depth);
+  }
+  search.states_searched++;
+
+  if (is_dead_state(state))
+    return;
+
+  vector<Move> moves;
+  generate_moves(state, moves);
+  search.ordering->order_moves(state, moves, depth);
+
+  vector<Move> safe_moves;
+  for (auto& move : moves) {
+    GameState next_state = state;
+    next_state.make_move(move);
+    safe_moves.clear();
+    next_state.apply_safe_moves(safe_moves);
+
+    search.line.push_back(move);
+    search.line.insert(search.line.end(), safe_moves.begin(), safe_moves.end());
+    search_below(search, next_state, depth + 1 + safe_moves.size());
+    search.line.erase(search.line.end() - 1 - safe_moves.size(), search.line.end());
+
+    // an implicit move is always made, so there's nothing else to try from here
+    if (move.implicit || search.stopped)
+      return;
+  }
+}
+
+bool solve_game_anytime(const GameState& game, vector<Move>& moves_to_win, chrono::steady_clock::time_point deadline,
+    const SolutionCallback& on_solution, const SolveOptions& options) {
+  if (game.win())
+    return true;
+
+  deadline = min(options.deadline, deadline);
+  vector<Move> first_moves;
+
+  // the first solution comes from the usual depth-first search, restarted with ties broken differently when it gives up
+  for (unsigned seed = 0; first_moves.empty(); seed++) {
+    if (chrono::steady_clock::now() >= deadline || (options.cancel && *options.cancel))
+      return false;
+
+    HeuristicMoveOrdering ordering(seed);
+    SolveStats stats;
+    SolveOptions search_options = options;
+    search_options.deadline = deadline;
+    search_options.stats = &stats;
+    if (seed > 0 || !options.ordering)
+      search_options.ordering = &ordering;
+
+    if (solve_game_dfs(game, first_moves, 1000, search_options))
+      break;
+    if (stats.result == WinResult::LOSE)
+      return false;   // every line was searched, so there's no solution to find
+  }
+
+  if (on_solution)
+    on_solution(first_moves);
+
+  // then a single branch and bound search, with each solution it finds lowering the bound for the rest of it.
+  // when it finishes before the deadline, the best solution is a shortest one
+  HeuristicMoveOrdering ordering;
+  AnytimeSearch search{{}, options.ordering ? options.ordering : &ordering, options, deadline, on_solution};
+  search.best_moves = first_moves;
+  search.bound = first_moves.size();
+
+  GameState start = game;
+  start.apply_safe_moves(search.line);
+  search_below(search, start, search.line.size());
+
+  moves_to_win.insert(moves_to_win.end(), search.best_moves.begin(), search.best_moves.end());
+  return true;
+}
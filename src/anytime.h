@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "game.h"
+
+// Called with each improved solution, in the same reverse order as moves_to_win
+typedef std::function<void(const std::vector<Move>& moves_to_win)> SolutionCallback;
+
+// Anytime search:  finds a first solution as quickly as possible with the depth-first solver, then keeps searching for
+// shorter ones with a single branch and bound search, where each solution found lowers the bound for the rest of it.
+// States are only skipped when they've already been searched from at least as few moves, so that the bound can keep
+// tightening.  It stops at the deadline, or once the search is finished and the best solution is a shortest one.
+// Every improvement is passed to on_solution, if given, and the best is returned in moves_to_win.
+bool solve_game_anytime(const GameState& game, std::vector<Move>& moves_to_win, std::chrono::steady_clock::time_point deadline,
+    const SolutionCallback& on_solution = nullptr, const SolveOptions& options = SolveOptions());
@@ -0,0 +1,230 @@
+#include "beam.h"
+#include "deadlock.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// how a kept state was reached:  its slot in the layer before, and the move from there
+struct BeamStep {
+  uint32_t parent;
+  int16_t from;
+  int16_t to;
+  uint8_t size;
+  bool implicit;
+};
+
+// a state in the next layer, ordered by its estimate and then its hash, so that ties are always broken the same way
+struct BeamCandidate {
+  int estimate;
+  size_t hash;
+  uint32_t slot;
+
+  friend bool operator<(const BeamCandidate& a, const BeamCandidate& b) {
+    return (a.estimate != b.estimate) ? (a.estimate < b.estimate) : (a.hash < b.hash);
+  }
+};
+
+static size_t hash_set_capacity(size_t count) {
+  size_t capacity = 1;
+  while (capacity < count * 2) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+// open addressing set of state hashes, with a fixed size that keeps it at most half full for the given count
+class BeamHashSet {
+public:
+  explicit BeamHashSet(size_t count) : slots(hash_set_capacity(count), 0), mask(slots.size() - 1) {}
+
+  bool contains(size_t hash) const {
+    hash = hash ? hash : 1;   // 0 marks an empty slot
+    for (size_t i = hash & mask; slots[i]; i = (i + 1) & mask) {
+      if (slots[i] == hash) return true;
+    }
+    return false;
+  }
+
+  // returns false if it was already there
+  bool insert(size_t hash) {
+    hash = hash ? hash : 1;
+    size_t i = hash & mask;
+    for (; slots[i]; i = (i + 1) & mask) {
+      if (slots[i] == hash) return false;
+    }
+    slots[i] = hash;
+    return true;
+  }
+
+  void clear() {
+    fill(slots.begin(), slots.end(), 0);
+  }
+
+private:
+  vector<size_t> slots;
+  size_t mask;
+};
+
+// everything a search needs, allocated once for the widest search and reused by the narrower ones before it
+struct BeamBuffers {
+  BeamBuffers(size_t max_width, int max_depth) :
+    layer(max_width), next_layer(max_width), steps(max_width * max_depth),
+    layer_states(max_width * 2), visited(max_width * max_depth) {
+    beam.reserve(max_width);
+  }
+
+  vector<GameState> layer;
+  vector<GameState> next_layer;
+  vector<BeamCandidate> beam;
+  vector<BeamStep> steps;             // steps[(depth-1) * width + slot] for each state kept at depth
+  BeamHashSet layer_states;
+  BeamHashSet visited;
+};
+
+size_t beam_memory(size_t max_width, int max_depth) {
+  return 2 * max_width * sizeof(GameState) + max_width * sizeof(BeamCandidate) + max_width * max_depth * sizeof(BeamStep) +
+    (hash_set_capacity(max_width * 2) + hash_set_capacity(max_width * max_depth)) * sizeof(size_t);
+}
+
+// cards that have to be moved off the next card of each suit before it can go to done
+static int covering_cards(const GameState& game) {
+  int count = 0;
+  for (int p = 0; p < num_piles; p++) {
+    for (int h = 0; h < game.pile_sizes[p]; h++) {
+      auto card = game.piles[p][h];
+      if (card.normal() && card.value() == game.done[card.suit()] + 1)
+        count += game.pile_sizes[p] - 1 - h;
+    }
+  }
+  return count;
+}
+
+// a search at one width
+static bool beam_search(const GameState& game, vector<Move>& moves_to_win, size_t width, const BeamOptions& options,
+    BeamBuffers& buffers, BeamStats& stats) {
+  auto estimate = [&] (const GameState& state) {
+    return options.pattern_db ? options.pattern_db->estimate(state, options.combine) : moves_to_done(state) + covering_cards(state);
+  };
+
+  auto& layer = buffers.layer;
+  auto& next_layer = buffers.next_layer;
+  auto& beam = buffers.beam;
+  auto& steps = buffers.steps;
+  auto& layer_states = buffers.layer_states;
+  auto& visited = buffers.visited;
+  visited.clear();
+  stats.width = width;
+  stats.emptied = false;
+
+  layer[0] = game;
+  size_t layer_size = 1;
+  GameState normalized = game;
+  normalized.normalize();
+  visited.insert(hash<GameState>()(normalized));
+
+  vector<Move> moves;
+
+  for (int depth = 0; depth < options.max_depth; depth++) {
+    if (options.cancel && *options.cancel)
+      break;
+
+    beam.clear();
+    layer_states.clear();
+    size_t layer_inserts = 0;
+
+    for (size_t i = 0; i < layer_size; i++) {
+      const GameState& state = layer[i];
+      generate_moves(state, moves);
+      stats.expanded++;
+
+      for (auto& move : moves) {
+        GameState next_state = state;
+        next_state.make_move(move);
+
+        // Found a winning state, so follow the steps back to the start
+        if (next_state.win()) {
+          stats.depth = depth + 1;
+          moves_to_win.push_back(move);
+          for (size_t slot = i, d = depth; d > 0; d--) {
+            auto& step = steps[(d-1) * width + slot];
+            moves_to_win.push_back(Move(step.from, step.to, step.size, step.implicit));
+            slot = step.parent;
+          }
+          return true;
+        }
+
+        if (is_dead_state(next_state))
+          continue;
+
+        normalized = next_state;
+        normalized.normalize();
+        size_t state_hash = hash<GameState>()(normalized);
+        if (visited.contains(state_hash))
+          continue;
+
+        // keep the state if the beam has room, or in place of the worst one kept so far.  a state that was kept and
+        // then replaced is no better than the worst one now, so only states that are still kept need to be remembered
+        BeamCandidate candidate{estimate(next_state), state_hash, (uint32_t) beam.size()};
+        bool full = (beam.size() == width);
+        if (full && !(candidate < beam.front()))
+          continue;
+        if (layer_states.contains(state_hash))
+          continue;
+
+        if (!full) {
+          beam.push_back(candidate);
+        } else {
+          candidate.slot = beam.front().slot;
+          pop_heap(beam.begin(), beam.end());
+          beam.back() = candidate;
+        }
+        push_heap(beam.begin(), beam.end());
+
+        // the replaced states are cleared out of the layer's set before it fills up
+        if (++layer_inserts > width) {
+          layer_states.clear();
+          for (auto& kept : beam) {
+            layer_states.insert(kept.hash);
+          }
+          layer_inserts = beam.size();
+        } else {
+          layer_states.insert(state_hash);
+        }
+
+        next_layer[candidate.slot] = next_state;
+        steps[depth * width + candidate.slot] = {(uint32_t) i, (int16_t) move.from, (int16_t) move.to, (uint8_t) move.size, move.implicit};
+      }
+    }
+
+    if (beam.empty()) {
+      stats.emptied = true;
+      break;
+    }
+
+    for (auto& candidate : beam) {
+      visited.insert(candidate.hash);
+    }
+    swap(layer, next_layer);
+    layer_size = beam.size();
+  }
+
+  return false;
+}
+
+bool solve_game_beam(const GameState& game, vector<Move>& moves_to_win, const BeamOptions& options) {
+  BeamStats stats;
+  bool result = game.win();
+  if (!result) {
+    BeamBuffers buffers(options.max_width, options.max_depth);
+    for (size_t width = options.width; width <= options.max_width; width *= 2) {
+      result = beam_search(game, moves_to_win, width, options, buffers, stats);
+      if (result || (options.cancel && *options.cancel))
+        break;
+    }
+  }
+
+  if (options.stats)
+    *options.stats = stats;
+  return result;
+}
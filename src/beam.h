@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "game.h"
+#include "pattern_db.h"
+
+// Beam search for a quick solution in a fixed amount of memory.
+//
+// The states are expanded a layer at a time like breadth-first search, but only the best width states of each layer
+// are kept, by their estimate of the moves left.  The estimate comes from the pattern database when one is given, and
+// otherwise is the moves to done still needed plus the cards covering the next card of each suit to go to done.
+// States are compared normalized, so no state is kept twice in a layer, or again in a later one.  When the beam runs
+// out of states, or reaches max_depth, the search is tried again at double the width, up to max_width.  Everything
+// the searches need at max_width and max_depth is allocated once before the first one starts, and reused by each
+// retry.  It's not complete, so a deal it can't solve may still be winnable.
+struct BeamStats {
+  size_t width = 0;                   // width of the last search tried
+  int depth = 0;                      // moves in the solution found, when there is one
+  size_t expanded = 0;                // states expanded, over every width tried
+  bool emptied = false;               // whether the last search ran out of states, rather than reaching max_depth
+};
+
+struct BeamOptions {
+  size_t width = 1000;
+  size_t max_width = 8000;
+  int max_depth = 400;                // layers before giving up, which bounds the solution length
+  const PatternDatabase* pattern_db = nullptr;
+  PatternDatabase::Combine combine = PatternDatabase::Combine::ADD;
+  const std::atomic<bool>* cancel = nullptr;
+  BeamStats* stats = nullptr;         // filled in at the end of the search, if given
+};
+
+bool solve_game_beam(const GameState& game, std::vector<Move>& moves_to_win, const BeamOptions& options = BeamOptions());
+
+// bytes allocated by searches up to the given width
+size_t beam_memory(size_t max_width, int max_depth);
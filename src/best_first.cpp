@@ -0,0 +1,131 @@
+#include "best_first.h"
+#include "deadlock.h"
+
+#include <queue>
+#include <unordered_map>
+
+using namespace std;
+
+// a stored state, along with the state it was best reached from
+struct BestFirstNode {
+  PackedState state;
+  int parent;
+  int moves;
+};
+
+bool solve_game_best_first(const GameState& game, vector<Move>& moves_to_win, const PatternDatabase* pattern_db,
+    PatternDatabase::Combine combine, size_t max_states, const atomic<bool>* cancel) {
+  if (game.win())
+    return true;
+
+  auto estimate = [&] (const GameState& state) {
+    return pattern_db ? pattern_db->estimate(state, combine) : moves_to_done(state);
+  };
+
+  vector<BestFirstNode> nodes;
+  unordered_map<PackedState, int, PackedStateHash> best_nodes;
+
+  // ordered by lowest estimated total, then by most moves made, so ties go deeper first
+  typedef tuple<int, int, int> OpenEntry;    // estimated total, -moves, node index
+  priority_queue<OpenEntry, vector<OpenEntry>, greater<OpenEntry>> open;
+
+  GameState start = game;
+  start.normalize();
+  nodes.push_back({start.pack(), -1, 0});
+  best_nodes[nodes[0].state] = 0;
+  open.emplace(estimate(start), 0, 0);
+
+  int win_node = -1;
+  int prev_total = -1;
+  size_t expanded = 0;
+  vector<Move> moves;
+
+  while (!open.empty() && win_node < 0) {
+    auto [total, negative_moves, index] = open.top();
+    open.pop();
+
+    // skip entries for states that were since reached in fewer moves
+    auto node = nodes[index];
+    if (best_nodes[node.state] != index)
+      continue;
+
+    if (total != prev_total) {
+      cout << "estimate: " << total << "  expanded: " << expanded << "  stored: " << nodes.size() << endl;
+      prev_total = total;
+    }
+
+    if (nodes.size() >= max_states || (cancel && *cancel))
+      break;
+
+    expanded++;
+    GameState state = GameState::unpack(node.state);
+    // no partial-order reduction here:  a state keeps only its best parent, so skipping moves that commute with the
+    // move reaching it could drop states that the other order only reaches through a parent already thrown away
+    generate_moves(state, moves);
+
+    for (auto& move : moves) {
+      GameState next_state = state;
+      next_state.make_move(move);
+
+      // Base case - we found a winning state!
+      // every other state is at least one move from a win, so no shorter solution is still waiting in the queue
+      if (next_state.win()) {
+        win_node = index;
+        break;
+      }
+
+      // Don't bother visiting states that can be proven unwinnable
+      if (is_dead_state(next_state))
+        continue;
+
+      next_state.normalize();
+      PackedState packed = next_state.pack();
+      int next_moves = node.moves + 1;
+
+      auto found = best_nodes.find(packed);
+      if (found != best_nodes.end() && nodes[found->second].moves <= next_moves)
+        continue;
+
+      int next_index = nodes.size();
+      nodes.push_back({packed, index, next_moves});
+      best_nodes[packed] = next_index;
+      open.emplace(next_moves + estimate(next_state), -next_moves, next_index);
+    }
+  }
+
+  cout << "expanded: " << expanded << "  stored: " << nodes.size() << endl;
+
+  if (win_node < 0)
+    return false;
+
+  // follow the parent links back to the start, then replay the line of normalized states from the actual game
+  vector<PackedState> line;
+  for (int i = win_node; nodes[i].parent >= 0; i = nodes[i].parent) {
+    line.push_back(nodes[i].state);
+  }
+
+  vector<Move> forward_moves;
+  GameState state = game;
+  for (auto i = line.rbegin(); i != line.rend(); i++) {
+    Move move(0, 0);
+    if (!find_move_to(state, GameState::unpack(*i), move))
+      return false;
+    forward_moves.push_back(move);
+    state.make_move(move);
+  }
+
+  // finally, the move that wins the game
+  generate_moves(state, moves, true);
+  for (auto& move : moves) {
+    GameState next_state = state;
+    next_state.make_move(move);
+    if (next_state.win()) {
+      forward_moves.push_back(move);
+      // solutions are returned in reverse order
+      moves_to_win.insert(moves_to_win.end(), forward_moves.rbegin(), forward_moves.rend());
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "game.h"
+#include "pattern_db.h"
+
+// Best-first (A*) search for a shortest solution, always expanding the state with the lowest estimated total moves.
+// Without a pattern database, the estimate is just the moves to done still needed.
+// With Combine::MAX the estimate is a true lower bound, so the solution found is a shortest one,
+// while Combine::ADD usually expands far fewer states but can return a longer solution.
+// The search gives up once cancel is set, if given.
+bool solve_game_best_first(const GameState& game, std::vector<Move>& moves_to_win, const PatternDatabase* pattern_db = nullptr,
+    PatternDatabase::Combine combine = PatternDatabase::Combine::MAX, size_t max_states = 10000000, const std::atomic<bool>* cancel = nullptr);
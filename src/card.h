@@ -1,24 +1,102 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <iostream>
 
+#include "rules.h"
+
+const int num_suits = Rules::num_suits;
+const int max_value = Rules::max_value;
+const int num_dragons = Rules::num_dragons;
+
+// cards are stored in one byte:  the suit plus one in the high bits, and the value plus num_dragons in the low bits,
+// which is also how they're packed.  every predicate is looked up in a table indexed by that byte, built at compile time
+const int card_value_bits = 4;
+const int num_card_codes = (num_suits + 1) << card_value_bits;
+const int card_mask_words = (num_card_codes + 63) / 64;
+
+static_assert(max_value + num_dragons < (1 << card_value_bits), "card values must fit in their bits");
+static_assert(num_card_codes <= 256, "card codes must fit in a byte");
+
+struct CardTables {
+  enum Flags : uint8_t {
+    PRESENT = 1,
+    DRAGON = 2,
+    DRAGON_DONE = 4,
+    BLANK = 8,
+    NORMAL = 16,
+  };
+
+  std::array<int8_t, num_card_codes> suits = {};
+  std::array<int8_t, num_card_codes> values = {};
+  std::array<uint8_t, num_card_codes> flags = {};
+  std::array<std::array<uint64_t, card_mask_words>, num_card_codes> stacks_onto = {};   // bit for each card code this card can be placed onto in a pile
+
+  constexpr bool stacks(uint8_t code, uint8_t onto) const { return (stacks_onto[code][onto / 64] >> (onto % 64)) & 1; }
+};
+
+constexpr CardTables make_card_tables() {
+  CardTables tables;
+  for (int code = 0; code < num_card_codes; code++) {
+    int suit = (code >> card_value_bits) - 1;
+    int value = (code & ((1 << card_value_bits) - 1)) - num_dragons;
+    tables.suits[code] = suit;
+    tables.values[code] = value;
+    tables.flags[code] =
+      (((suit != 0) || (value != 0)) ? CardTables::PRESENT : 0) |
+      (((suit >= 0) && (value < 0)) ? CardTables::DRAGON : 0) |
+      (((suit >= 0) && (value < -1)) ? CardTables::DRAGON_DONE : 0) |
+      ((suit < 0) ? CardTables::BLANK : 0) |
+      (((suit >= 0) && (value >= 0)) ? CardTables::NORMAL : 0);
+  }
+
+  for (int code = 0; code < num_card_codes; code++) {
+    for (int onto = 0; onto < num_card_codes; onto++) {
+      bool legal = false;
+      if (!(tables.flags[code] & CardTables::PRESENT)) {
+        legal = false;  // no card to move
+      } else if (!(tables.flags[onto] & CardTables::PRESENT)) {
+        legal = true;   // can always place onto empty pile
+      } else if (tables.flags[onto] & tables.flags[code] & CardTables::NORMAL) {
+        // ascending order of different suit, and never onto or with a dragon or blank
+        legal = (tables.values[code] == tables.values[onto] - 1) && (tables.suits[code] != tables.suits[onto]);
+      }
+      if (legal)
+        tables.stacks_onto[code][onto / 64] |= 1ULL << (onto % 64);
+    }
+  }
+
+  return tables;
+}
+
+inline constexpr CardTables card_tables = make_card_tables();
+
 class Card {
 public:
-  Card();
-  Card(int suit, int value);
+  constexpr Card() : code(card_code(0, 0)) {}
+  constexpr Card(int suit, int value) : code(card_code(suit, value)) {}
+
+  static constexpr Card from_code(uint8_t code) { Card card; card.code = code; return card; }
+  static constexpr uint8_t card_code(int suit, int value) { return ((suit + 1) << card_value_bits) | (value + num_dragons); }
+
+  uint8_t code;
+
+  int suit() const { return card_tables.suits[code]; }
+  int value() const { return card_tables.values[code]; }
 
-  int suit;
-  int value;
+  bool present() const { return card_tables.flags[code] & CardTables::PRESENT; }
+  bool dragon() const { return card_tables.flags[code] & CardTables::DRAGON; }
+  bool dragon_done() const { return card_tables.flags[code] & CardTables::DRAGON_DONE; }
+  bool blank() const { return card_tables.flags[code] & CardTables::BLANK; }
+  bool normal() const { return card_tables.flags[code] & CardTables::NORMAL; }
 
-  bool present() const;
-  bool dragon() const;
-  bool dragon_done() const;
-  bool blank() const;
-  bool normal() const;
+  // whether this card can be placed onto the other one in a pile, or onto an empty pile when it's no card
+  bool stacks_onto(const Card& onto_card) const { return card_tables.stacks(code, onto_card.code); }
 
   friend std::ostream& operator<<(std::ostream& os, const Card& card);
-  friend bool operator==(const Card& c1, const Card& c2);
-  friend bool operator!=(const Card& c1, const Card& c2);
+  friend bool operator==(const Card& c1, const Card& c2) { return c1.code == c2.code; }
+  friend bool operator!=(const Card& c1, const Card& c2) { return c1.code != c2.code; }
   friend bool operator<(const Card& c1, const Card& c2);
 };
 
@@ -0,0 +1,102 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+struct CheckpointHeader {
+  char     magic[8];
+  RulesSignature rules;
+  uint8_t  deal[packed_state_size];
+  uint8_t  padding;
+  int32_t  max_depth;
+  int32_t  best_cards_done;
+  uint64_t states_searched;
+  double   seconds;
+  uint64_t num_line;
+  uint64_t num_visited;
+};
+
+static const char checkpoint_magic[8] = {'S', 'H', 'Z', 'X', 'C', 'P', '0', '2'};
+
+static PackedState deal_key(const GameState& game) {
+  GameState normalized = game;
+  normalized.normalize();
+  return normalized.pack();
+}
+
+bool write_checkpoint(const string& path, const GameState& game, int max_depth, const DfsCheckpoint& checkpoint,
+    const vector<const GameState*>& line, const unordered_set<GameState>& visited_states) {
+  CheckpointHeader header = {};
+  memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+  header.rules = RulesSignature::current();
+  auto deal = deal_key(game);
+  copy(deal.begin(), deal.end(), header.deal);
+  header.max_depth = max_depth;
+  header.best_cards_done = checkpoint.best_cards_done;
+  header.states_searched = checkpoint.states_searched;
+  header.seconds = checkpoint.seconds;
+  header.num_line = line.size();
+  header.num_visited = visited_states.size();
+
+  string temp_path = path + ".tmp";
+  ofstream out(temp_path, ios::binary);
+  out.write((const char*) &header, sizeof(header));
+  for (auto state : line) {
+    auto packed = state->pack();
+    out.write((const char*) packed.data(), packed.size());
+  }
+  for (auto& state : visited_states) {
+    auto packed = state.pack();
+    out.write((const char*) packed.data(), packed.size());
+  }
+  out.close();
+
+  if (!out) {
+    remove(temp_path.c_str());
+    return false;
+  }
+  return rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+bool read_checkpoint(const string& path, const GameState& game, int max_depth, DfsCheckpoint& checkpoint,
+    unordered_set<GameState>& visited_states) {
+  ifstream in(path, ios::binary);
+  CheckpointHeader header;
+  if (!in || !in.read((char*) &header, sizeof(header)))
+    return false;
+
+  auto deal = deal_key(game);
+  if (memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0 || !header.rules.matches_current() ||
+      memcmp(header.deal, deal.data(), deal.size()) != 0 || header.max_depth != max_depth)
+    return false;
+
+  PackedState packed;
+  vector<GameState> line;
+  for (uint64_t i = 0; i < header.num_line; i++) {
+    if (!in.read((char*) packed.data(), packed.size()))
+      return false;
+    line.push_back(GameState::unpack(packed));
+  }
+
+  unordered_set<GameState> visited;
+  visited.reserve(header.num_visited);
+  for (uint64_t i = 0; i < header.num_visited; i++) {
+    if (!in.read((char*) packed.data(), packed.size()))
+      return false;
+    visited.insert(GameState::unpack(packed));
+  }
+
+  // the states on the line were still being searched
+  for (auto& state : line) {
+    visited.erase(state);
+  }
+
+  checkpoint.states_searched = header.states_searched;
+  checkpoint.best_cards_done = header.best_cards_done;
+  checkpoint.seconds = header.seconds;
+  visited_states.swap(visited);
+  return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "game.h"
+
+// Saved progress of a depth-first search, so a search that was stopped can carry on from where it was.
+//
+// The file holds the deal and depth limit it's for, the search stats, the normalized states on the line being
+// searched, and every visited state, each as a packed state.  When resuming, the states on the line are taken back
+// out of the visited states, so the search goes back down the same line while skipping everything already searched.
+struct DfsCheckpoint {
+  size_t states_searched = 0;
+  int best_cards_done = 0;
+  double seconds = 0;         // time spent searching before the checkpoint, over every run
+};
+
+// Writes the checkpoint to a temporary file first, then renames it over the old one, so a checkpoint is never left half written
+bool write_checkpoint(const std::string& path, const GameState& game, int max_depth, const DfsCheckpoint& checkpoint,
+    const std::vector<const GameState*>& line, const std::unordered_set<GameState>& visited_states);
+
+// Reads the checkpoint into visited_states, and returns false if it's missing, damaged, or for another deal or depth limit
+bool read_checkpoint(const std::string& path, const GameState& game, int max_depth, DfsCheckpoint& checkpoint,
+    std::unordered_set<GameState>& visited_states);
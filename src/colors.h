@@ -5,9 +5,11 @@
 const std::string red("\033[0;31m");
 const std::string green("\033[0;32m");
 const std::string blue("\033[0;34m");
+const std::string yellow("\033[0;33m");
 
 const std::string inverse_red("\033[7;31m");
 const std::string inverse_green("\033[7;32m");
 const std::string inverse_blue("\033[7;34m");
+const std::string inverse_yellow("\033[7;33m");
 
 const std::string reset("\033[0m");
@@ -0,0 +1,169 @@
+#include "deadlock.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// The analysis computes an over-approximation of everything that could ever happen from this state,
+// as a least fixpoint of necessary conditions:
+//
+//  - a card can leave its pile only if every card above it leaves first (or moves along with it as part of a run),
+//    and it has somewhere to go:  done, a free slot, an empty pile, or a card that could ever be exposed to place it on.
+//  - a card can reach done only if the previous card of its suit reaches done, and the card is ever exposed.
+//  - dragons can be collected only if all of them are ever exposed, and there is a slot for them.
+//  - a slot or pile can only ever become free if some slot card can leave, or some pile can be cleared.
+//    as soon as that is possible, every card can eventually be moved and nothing can be proven.
+//
+// Every event in a real line of play has preconditions that happened earlier, so if the fixpoint
+// can't reach a won position, then no line of play can.
+
+static bool run_link(const Card& lower, const Card& upper) {
+  return lower.normal() && upper.normal() && (lower.suit() != upper.suit()) && (lower.value() == upper.value() + 1);
+}
+
+bool is_dead_state(const GameState& game) {
+  // with a free slot or an empty pile, every card can eventually be moved, so nothing can be proven
+  for (int s = 0; s < num_suits; s++) {
+    if (!game.slots[s].present()) return false;
+  }
+  if (game.empty_piles) return false;
+
+  // where each normal card is:  a pile and height, or a slot (pile of -1)
+  int card_pile[num_suits][max_value+1];
+  int card_height[num_suits][max_value+1];
+
+  for (int s = 0; s < num_suits; s++) {
+    auto card = game.slots[s];
+    if (card.normal()) {
+      card_pile[card.suit()][card.value()] = -1;
+    }
+  }
+  for (int p = 0; p < num_piles; p++) {
+    for (int h = 0; h < game.pile_sizes[p]; h++) {
+      auto card = game.piles[p][h];
+      if (card.normal()) {
+        card_pile[card.suit()][card.value()] = p;
+        card_height[card.suit()][card.value()] = h;
+      }
+    }
+  }
+
+  int  cleared[num_piles] = {};   // how many cards from the top of each pile can leave
+  int  done_to[num_suits];        // highest value of each suit that can reach done
+  bool dragons_done[num_suits];
+
+  for (int s = 0; s < num_suits; s++) {
+    done_to[s] = game.done[s];
+    dragons_done[s] = false;
+  }
+  for (int s = 0; s < num_suits; s++) {
+    if (game.slots[s].dragon_done())
+      dragons_done[game.slots[s].suit()] = true;
+  }
+
+  auto exposed = [&] (int p, int h) {
+    return h >= game.pile_sizes[p] - 1 - cleared[p];
+  };
+
+  // whether the given card could ever be exposed while still in play
+  auto card_exposed = [&] (int suit, int value) {
+    if (game.done[suit] >= value) return false;
+    int p = card_pile[suit][value];
+    return (p < 0) || exposed(p, card_height[suit][value]);
+  };
+
+  // whether there is any card that could ever be exposed to place the given card on
+  auto can_place = [&] (const Card& card) {
+    if (!card.normal() || card.value() >= max_value) return false;
+    for (int s = 0; s < num_suits; s++) {
+      if (s != card.suit() && card_exposed(s, card.value() + 1)) return true;
+    }
+    return false;
+  };
+
+  auto can_leave = [&] (const Card& card) {
+    if (card.blank()) return true;
+    if (card.dragon()) return dragons_done[card.suit()];
+    if (done_to[card.suit()] >= card.value()) return true;
+    return can_place(card);
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+
+    // cards that can leave the top of each pile, either on their own or as part of a run with a card below them
+    for (int p = 0; p < num_piles; p++) {
+      int size = game.pile_sizes[p];
+      bool extended = true;
+      while (extended && cleared[p] < size) {
+        extended = false;
+        int h = size - 1 - cleared[p];
+        for (int b = h; b >= 0; b--) {
+          if (b < h && !run_link(game.piles[p][b], game.piles[p][b+1]))
+            break;
+          if (can_leave(game.piles[p][b])) {
+            cleared[p] = size - b;
+            extended = true;
+            changed = true;
+            break;
+          }
+        }
+      }
+    }
+
+    // progress of each suit to done
+    for (int s = 0; s < num_suits; s++) {
+      while (done_to[s] < max_value && card_exposed(s, done_to[s] + 1)) {
+        done_to[s]++;
+        changed = true;
+      }
+    }
+
+    // dragons, which need all of them exposed at once and a slot to go into
+    for (int d = 0; d < num_suits; d++) {
+      if (dragons_done[d]) continue;
+
+      int showing = 0;
+      int in_slots = 0;
+      for (int s = 0; s < num_suits; s++) {
+        auto card = game.slots[s];
+        if (card.dragon() && card.suit() == d) {
+          showing++;
+          in_slots++;
+        }
+      }
+      for (int p = 0; p < num_piles; p++) {
+        for (int h = max(0, game.pile_sizes[p] - 1 - cleared[p]); h < game.pile_sizes[p]; h++) {
+          auto card = game.piles[p][h];
+          if (card.dragon() && card.suit() == d)
+            showing++;
+        }
+      }
+
+      if (showing == num_dragons && in_slots > 0) {
+        dragons_done[d] = true;
+        changed = true;
+        if (in_slots > 1)
+          return false;  // frees up a slot
+      }
+    }
+
+    // once a slot or pile can be freed up, every card can eventually be moved, so nothing can be proven
+    for (int s = 0; s < num_suits; s++) {
+      auto card = game.slots[s];
+      if (!card.dragon() && can_leave(card))
+        return false;
+    }
+    for (int p = 0; p < num_piles; p++) {
+      if (cleared[p] == game.pile_sizes[p])
+        return false;
+    }
+  }
+
+  for (int s = 0; s < num_suits; s++) {
+    if (done_to[s] < max_value) return true;
+    if (!dragons_done[s]) return true;
+  }
+  return false;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "game.h"
+
+// Fast static check that proves a state can never be won, without searching below it.
+// Returns false whenever it can't prove anything, so a false result does not mean the state is winnable.
+bool is_dead_state(const GameState& game);
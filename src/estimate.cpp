@@ -0,0 +1,129 @@
+#include "estimate.h"
+#include "move_order.h"
+#include "solution_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+RateEstimate SolvabilityEstimate::rate(size_t count, double z) const {
+  RateEstimate result;
+  if (deals == 0)
+    return result;
+
+  double n = deals;
+  double p = count / n;
+  double denominator = 1 + z * z / n;
+  double center = (p + z * z / (2 * n)) / denominator;
+  double half = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / denominator;
+
+  result.rate = p;
+  result.low = max(0.0, center - half);
+  result.high = min(1.0, center + half);
+  return result;
+}
+
+double SolvabilityEstimate::precision(double z) const {
+  double widest = 0;
+  for (size_t count : {won, lost, unknown}) {
+    auto estimate = rate(count, z);
+    widest = max(widest, (estimate.high - estimate.low) / 2);
+  }
+  return widest;
+}
+
+SolvabilityEstimate estimate_solvability(const SolvabilityOptions& options, const function<void(const SolvabilityEstimate&)>& progress) {
+  SolvabilityEstimate estimate;
+  if (options.last_seed < options.first_seed)
+    return estimate;
+
+  int num_threads = options.num_threads;
+  if (num_threads <= 0)
+    num_threads = max(1u, thread::hardware_concurrency());
+
+  uint64_t range = (uint64_t) options.last_seed - options.first_seed + 1;
+  size_t max_deals = min<uint64_t>(options.max_deals, range);
+
+  // seeds are sampled in the order of a random affine permutation of the range, so none is dealt twice
+  mt19937_64 rng(options.sample_seed);
+  uint64_t offset = rng() % range;
+  uint64_t multiplier = 1;
+  if (range > 1) {
+    do {
+      multiplier = 1 + rng() % (range - 1);
+    } while (gcd(multiplier, range) != 1);
+  }
+  auto seed_of = [&] (size_t i) {
+    return (unsigned) (options.first_seed + (multiplier * i + offset) % range);
+  };
+
+  mutex lock;
+  atomic<size_t> next_deal(0);
+  atomic<bool> stop(false);
+  map<size_t, WinResult> finished;    // deals finished before some sampled ahead of them, waiting to be counted
+
+  auto search = [&] {
+    for (size_t i = next_deal++; i < max_deals && !stop; i = next_deal++) {
+      GameState game = GameState::create_random(seed_of(i));
+
+      HeuristicMoveOrdering ordering;
+      SolveStats stats;
+      SolveOptions solve_options;
+      solve_options.ordering = &ordering;
+      solve_options.max_states = options.max_states;
+      solve_options.tablebase = options.tablebase;
+      solve_options.cancel = &stop;
+      solve_options.deadline = chrono::steady_clock::now() + options.max_time;
+      solve_options.stats = &stats;
+
+      vector<Move> moves_to_win;
+      if (options.cache) {
+        solve_game_cached(game, moves_to_win, options.max_depth, solve_options, *options.cache);
+      } else {
+        solve_game_dfs(game, moves_to_win, options.max_depth, solve_options);
+      }
+      if (stop)
+        break;  // the search may have been cut short, and the estimate is final anyway
+
+      lock_guard<mutex> guard(lock);
+      finished[i] = stats.result;
+
+      bool counted = false;
+      for (auto f = finished.begin(); f != finished.end() && f->first == estimate.deals; f = finished.erase(f)) {
+        if (f->second == WinResult::WIN) {
+          estimate.won++;
+        } else if (f->second == WinResult::LOSE) {
+          estimate.lost++;
+        } else {
+          estimate.unknown++;
+        }
+        estimate.deals++;
+        counted = true;
+      }
+      if (!counted)
+        continue;
+
+      if (progress)
+        progress(estimate);
+      if (estimate.deals >= max_deals || (estimate.deals >= options.min_deals && estimate.precision(options.z) <= options.precision))
+        stop = true;
+    }
+  };
+
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back(search);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return estimate;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include "game.h"
+
+class SolutionCache;
+class Tablebase;
+
+// Estimates of the fraction of deals that can be won, from a random sample of seeds.
+//
+// Each sampled deal gets a depth-first search with a budget of states and time, and is counted as won, lost when every
+// line was searched, or unknown when the budget ran out first.  Each rate gets a Wilson score interval, which holds
+// up for small samples and rates near 0 or 1.  Sampling stops once every interval is within the target precision,
+// or the sample limit is reached.  Deals are counted in the order they were sampled, even when threads finish them
+// out of order, so that hard deals still being searched when sampling stops can't bias the rates.
+struct SolvabilityOptions {
+  unsigned first_seed = 1;
+  unsigned last_seed = 1000000;       // inclusive
+  unsigned sample_seed = 1;           // picks which seeds are sampled, and in what order
+  size_t max_deals = 100000;          // also never more than the seeds in the range
+  size_t min_deals = 100;             // sampled before checking the precision, so a lucky start can't stop it
+  double precision = 0.01;            // stops once each interval is at most twice this wide
+  double z = 1.96;                    // normal quantile of the confidence level, 1.96 for 95%
+  int max_states = 100000;            // budget for each deal
+  std::chrono::milliseconds max_time = std::chrono::milliseconds(10000);
+  int max_depth = 1000;
+  const Tablebase* tablebase = nullptr;
+  SolutionCache* cache = nullptr;     // answers from earlier searches, where new results are stored too, if given
+  int num_threads = 0;                // 0 for all cores
+};
+
+struct RateEstimate {
+  double rate = 0;
+  double low = 0;
+  double high = 1;
+};
+
+struct SolvabilityEstimate {
+  size_t deals = 0;
+  size_t won = 0;
+  size_t lost = 0;
+  size_t unknown = 0;
+
+  RateEstimate rate(size_t count, double z) const;
+  double precision(double z) const;   // half the width of the widest interval of the three rates
+};
+
+// progress, if given, is called each time more deals are counted, from whichever thread counted them
+SolvabilityEstimate estimate_solvability(const SolvabilityOptions& options,
+  const std::function<void(const SolvabilityEstimate&)>& progress = nullptr);
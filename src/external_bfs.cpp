@@ -0,0 +1,261 @@
+#include "external_bfs.h"
+#include "deadlock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <queue>
+
+using namespace std;
+
+static string layer_path(const string& dir, int depth) {
+  return dir + "/layer_" + to_string(depth) + ".bin";
+}
+
+static string run_path(const string& dir, int depth, int run) {
+  return dir + "/layer_" + to_string(depth) + ".run" + to_string(run);
+}
+
+// sequential reader over a file of sorted packed states
+class LayerReader {
+public:
+  LayerReader(const string& path) : in(path, ios::binary) {
+    advance();
+  }
+
+  bool valid() const { return has_current; }
+  const PackedState& current() const { return current_state; }
+
+  void advance() {
+    has_current = (bool) in.read((char*) current_state.data(), packed_state_size);
+  }
+
+private:
+  ifstream in;
+  PackedState current_state;
+  bool has_current;
+};
+
+// a full disk or unwritable directory would otherwise look like a layer with no states in it
+static bool check_written(ofstream& out, const string& path) {
+  out.close();
+  if (!out)
+    cout << "Can't write " << path << endl;
+  return (bool) out;
+}
+
+static bool write_run(vector<PackedState>& states, const string& path) {
+  sort(states.begin(), states.end());
+  auto last = unique(states.begin(), states.end());
+
+  ofstream out(path, ios::binary);
+  for (auto i = states.begin(); i != last && out; i++) {
+    out.write((const char*) i->data(), packed_state_size);
+  }
+  states.clear();
+  return check_written(out, path);
+}
+
+// merge the sorted runs of a new layer into a single layer file,
+// dropping duplicates and any state that already appears in a previous layer
+static bool merge_layer(const string& dir, int depth, int runs, size_t& count) {
+  vector<unique_ptr<LayerReader>> readers;
+  for (int r = 0; r < runs; r++) {
+    readers.emplace_back(new LayerReader(run_path(dir, depth, r)));
+  }
+  for (int d = 0; d < depth; d++) {
+    readers.emplace_back(new LayerReader(layer_path(dir, d)));
+  }
+
+  auto greater_state = [&] (int l, int r) {
+    return readers[l]->current() > readers[r]->current();
+  };
+  priority_queue<int, vector<int>, decltype(greater_state)> heap(greater_state);
+  for (int i = 0; i < (int) readers.size(); i++) {
+    if (readers[i]->valid())
+      heap.push(i);
+  }
+
+  ofstream out(layer_path(dir, depth), ios::binary);
+  count = 0;
+
+  while (!heap.empty() && out) {
+    PackedState state = readers[heap.top()]->current();
+    bool seen_before = false;
+
+    // consume every reader positioned at this state
+    while (!heap.empty() && readers[heap.top()]->current() == state) {
+      int i = heap.top();
+      heap.pop();
+      if (i >= runs)
+        seen_before = true;
+      readers[i]->advance();
+      if (readers[i]->valid())
+        heap.push(i);
+    }
+
+    if (!seen_before) {
+      out.write((const char*) state.data(), packed_state_size);
+      count++;
+    }
+  }
+
+  readers.clear();
+  for (int r = 0; r < runs; r++) {
+    remove(run_path(dir, depth, r).c_str());
+  }
+
+  return check_written(out, layer_path(dir, depth));
+}
+
+// walk back through the layer files to find a line of normalized states from the start to the given state,
+// then replay that line from the actual game to recover the moves
+static bool reconstruct_moves(const GameState& game, const string& dir, int depth, const PackedState& last_state, vector<Move>& forward_moves) {
+  vector<PackedState> line(depth+1);
+  line[depth] = last_state;
+
+  vector<Move> moves;
+  for (int d = depth-1; d >= 0; d--) {
+    bool found = false;
+    for (LayerReader reader(layer_path(dir, d)); reader.valid() && !found; reader.advance()) {
+      GameState state = GameState::unpack(reader.current());
+      generate_moves(state, moves);
+      for (auto& move : moves) {
+        GameState next_state = state;
+        next_state.make_move(move);
+        next_state.normalize();
+        if (next_state.pack() == line[d+1]) {
+          line[d] = reader.current();
+          found = true;
+          break;
+        }
+      }
+    }
+    if (!found)
+      return false;
+  }
+
+  GameState state = game;
+  for (int d = 1; d <= depth; d++) {
+    Move move(0, 0);
+    if (!find_move_to(state, GameState::unpack(line[d]), move))
+      return false;
+    forward_moves.push_back(move);
+    state.make_move(move);
+  }
+
+  // finally, the move that wins the game
+  generate_moves(state, moves, true);
+  for (auto& move : moves) {
+    GameState next_state = state;
+    next_state.make_move(move);
+    if (next_state.win()) {
+      forward_moves.push_back(move);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool solve_game_external_bfs(const GameState& game, vector<Move>& moves_to_win, const string& dir, size_t max_states_in_memory,
+    bool* failed) {
+  if (failed)
+    *failed = false;
+  if (game.win())
+    return true;
+
+  error_code error;
+  filesystem::create_directories(dir, error);
+
+  vector<PackedState> buffer;
+  buffer.reserve(max_states_in_memory);
+
+  GameState start = game;
+  start.normalize();
+  buffer.push_back(start.pack());
+
+  bool result = false;
+  bool written = write_run(buffer, layer_path(dir, 0));
+  int depth = 0;
+  vector<Move> moves;
+
+  while (written) {
+    bool found = false;
+    PackedState winning_parent;
+    int runs = 0;
+
+    // expand every state in the current layer, flushing sorted runs of children to disk as the buffer fills up
+    for (LayerReader reader(layer_path(dir, depth)); reader.valid() && !found && written; reader.advance()) {
+      GameState state = GameState::unpack(reader.current());
+      generate_moves(state, moves);
+
+      for (auto& move : moves) {
+        GameState next_state = state;
+        next_state.make_move(move);
+
+        // Base case - we found a winning state!
+        if (next_state.win()) {
+          winning_parent = reader.current();
+          found = true;
+          break;
+        }
+
+        // Don't bother visiting states that can be proven unwinnable
+        if (is_dead_state(next_state))
+          continue;
+
+        next_state.normalize();
+        buffer.push_back(next_state.pack());
+        if (buffer.size() >= max_states_in_memory) {
+          written = write_run(buffer, run_path(dir, depth+1, runs++));
+          if (!written)
+            break;
+        }
+      }
+    }
+    if (written && !found && !buffer.empty())
+      written = write_run(buffer, run_path(dir, depth+1, runs++));
+
+    // the next layer isn't needed once a win is found, or can't be finished
+    if (found || !written) {
+      buffer.clear();
+      for (int r = 0; r < runs; r++) {
+        remove(run_path(dir, depth+1, r).c_str());
+      }
+    }
+    if (!written)
+      break;
+
+    if (found) {
+      vector<Move> forward_moves;
+      result = reconstruct_moves(game, dir, depth, winning_parent, forward_moves);
+      if (result) {
+        // solutions are returned in reverse order
+        moves_to_win.insert(moves_to_win.end(), forward_moves.rbegin(), forward_moves.rend());
+      }
+      break;
+    }
+
+    depth++;
+    size_t layer_size = 0;
+    written = merge_layer(dir, depth, runs, layer_size);
+    if (!written)
+      break;
+    cout << "depth: " << depth << "  states: " << layer_size << "  runs: " << runs << endl;
+
+    if (layer_size == 0)
+      break;  // no solution found
+  }
+
+  // clean up the layer files
+  for (int d = 0; d <= depth; d++) {
+    remove(layer_path(dir, d).c_str());
+  }
+
+  if (failed)
+    *failed = !written;
+  return result;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Breadth-first search which streams each depth layer to files in the given directory.
+// Duplicates are detected by sorting each new layer and merging it against the previous layers,
+// so the set of visited states never has to fit in memory.  Returns false with failed set, if given,
+// when the layer files can't be written.
+bool solve_game_external_bfs(const GameState& game, std::vector<Move>& moves_to_win, const std::string& dir,
+    size_t max_states_in_memory = 1 << 22, bool* failed = nullptr);
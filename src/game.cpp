@@ -1,10 +1,18 @@
 #include "game.h"
+#include "deadlock.h"
+#include "move_order.h"
+#include "tablebase.h"
+#include "checkpoint.h"
+#include "session.h"
+#include "pile_moves.h"
 #include "magic_enum.hpp"
 
 #include <unordered_set>
 #include <vector>
 #include <queue>
 #include <algorithm>
+#include <mutex>
+#include <cstdio>
 
 using namespace std;
 
@@ -68,20 +76,27 @@ size_t std::hash<GameState>::operator()(const GameState& g) const
 
   for (int p = 0; p < num_piles; p++) {
     for (int h = 0; h < g.pile_sizes[p]; h++) {
-      result = (result * 16777619) ^ g.piles[p][h].suit;
-      result = (result * 16777619) ^ g.piles[p][h].value;
+      result = (result * 16777619) ^ g.piles[p][h].code;
     }
   }
 
   for (int s = 0; s < num_suits; s++) {
-    result = (result * 16777619) ^ g.slots[s].suit;
-    result = (result * 16777619) ^ g.slots[s].value;
+    result = (result * 16777619) ^ g.slots[s].code;
     result = (result * 16777619) ^ g.done[s];
   }
 
   return result ^ (g.blank_done << 1);
 }
 
+size_t PackedStateHash::operator()(const PackedState& p) const
+{
+  size_t result = 2166136261;
+  for (auto b : p) {
+    result = (result * 16777619) ^ b;
+  }
+  return result;
+}
+
 
 bool operator==(const GameState& g1, const GameState& g2)
 {
@@ -118,7 +133,9 @@ GameState::GameState() {
 
   for (int i=0; i < num_piles; i++) {
     pile_sizes[i] = 0;
+    run_lengths[i] = 0;
   }
+  index_tops();
 }
 
 bool GameState::win() const {
@@ -129,6 +146,9 @@ bool GameState::win() const {
     if (!slots[s].dragon_done()) return false;
   }
   if (blank_done != num_blanks) return false;
+  for (int p = 0; p < num_piles; p++) {
+    if (pile_sizes[p] != 0) return false;
+  }
   return true;
 }
 
@@ -137,19 +157,171 @@ const Card &GameState::top_card_of_pile(int pile) const {
   return piles[pile][pile_sizes[pile]-1];
 }
 
+const Card &GameState::run_bottom(int pile) const {
+  if (pile_sizes[pile] <= 0) return no_card;
+  return piles[pile][pile_sizes[pile]-run_lengths[pile]];
+}
+
+PileMask GameState::destinations(const Card& card) const {
+  if (!card.present()) return 0;
+
+  // any empty pile, or a card one higher of another suit
+  PileMask result = empty_piles;
+  if (card.normal() && card.value() < max_value) {
+    for (int s = 0; s < num_suits; s++) {
+      if (s != card.suit())
+        result |= piles_by_top[card.value()+1][s];
+    }
+  }
+
+  // and only piles with room for another card
+  for (int p = 0; p < num_piles; p++) {
+    if (pile_sizes[p] >= max_pile_size)
+      result &= ~(1 << p);
+  }
+  return result;
+}
+
+void GameState::index_top(int pile, bool add) {
+  PileMask* entry;
+  if (pile_sizes[pile] == 0) {
+    entry = &empty_piles;
+  } else {
+    auto card = piles[pile][pile_sizes[pile]-1];
+    if (!card.normal()) return;
+    entry = &piles_by_top[card.value()][card.suit()];
+  }
+
+  if (add) {
+    *entry |= (1 << pile);
+  } else {
+    *entry &= ~(1 << pile);
+  }
+}
+
+void GameState::index_tops() {
+  for (int v = 0; v <= max_value; v++) {
+    for (int s = 0; s < num_suits; s++) {
+      piles_by_top[v][s] = 0;
+    }
+  }
+  empty_piles = 0;
+  for (int p = 0; p < num_piles; p++) {
+    index_top(p, true);
+  }
+}
+
+void GameState::scan_run(int pile) {
+  int size = pile_sizes[pile];
+  int run = (size > 0) ? 1 : 0;
+  while (run < size && piles[pile][size-run].stacks_onto(piles[pile][size-run-1])) {
+    run++;
+  }
+  run_lengths[pile] = run;
+}
+
+void GameState::update_piles() {
+  for (int p = 0; p < num_piles; p++) {
+    scan_run(p);
+  }
+  index_tops();
+}
+
+void GameState::remove_cards(int pile, int count) {
+  index_top(pile, false);
+  for (int i = 0; i < count; i++) {
+    piles[pile][--pile_sizes[pile]] = no_card;
+  }
+
+  // the rest of the run is still a run, but a whole run removed leaves a new one to find
+  if (run_lengths[pile] > count) {
+    run_lengths[pile] -= count;
+  } else {
+    scan_run(pile);
+  }
+  index_top(pile, true);
+}
+
+void GameState::add_cards(int pile, const Card* cards, int count) {
+  index_top(pile, false);
+  bool extends_run = (pile_sizes[pile] > 0) && cards[0].stacks_onto(top_card_of_pile(pile));
+  for (int i = 0; i < count; i++) {
+    piles[pile][pile_sizes[pile]++] = cards[i];
+  }
+
+  run_lengths[pile] = extends_run ? (run_lengths[pile] + count) : count;
+  index_top(pile, true);
+}
+
+// cards are packed as their one byte code, with the suit in the high bits and the value in the low bits.
+// piles are written in order, each followed by a terminator, and the remainder is padded with zeros
+static const uint8_t pile_terminator = 0xff;
+
+static uint8_t pack_card(const Card& card) {
+  return card.code;
+}
+
+static Card unpack_card(uint8_t b) {
+  return Card::from_code(b);
+}
+
+PackedState GameState::pack() const {
+  PackedState result = {};
+  int i = 0;
+
+  for (int p = 0; p < num_piles; p++) {
+    for (int h = 0; h < pile_sizes[p]; h++) {
+      result[i++] = pack_card(piles[p][h]);
+    }
+    result[i++] = pile_terminator;
+  }
+
+  for (int s = 0; s < num_suits; s++) {
+    result[i++] = pack_card(slots[s]);
+    result[i++] = done[s];
+  }
+  result[i++] = blank_done;
+
+  return result;
+}
+
+GameState GameState::unpack(const PackedState& packed) {
+  GameState result;
+  int i = 0;
+
+  for (int p = 0; p < num_piles; p++) {
+    int h = 0;
+    while (packed[i] != pile_terminator) {
+      result.piles[p][h++] = unpack_card(packed[i++]);
+    }
+    result.pile_sizes[p] = h;
+    i++;
+  }
+
+  for (int s = 0; s < num_suits; s++) {
+    result.slots[s] = unpack_card(packed[i++]);
+    result.done[s] = packed[i++];
+  }
+  result.blank_done = packed[i++];
+  result.update_piles();
+
+  return result;
+}
+
 GameState GameState::create_random() {
   GameState result;
 
   for (int i=0; i < num_piles; i++) {
-    result.pile_sizes[i] = init_pile_size;
+    result.pile_sizes[i] = 0;
   }
 
-  // initial cards in order
+  // initial cards in order.  when they don't divide evenly, the first piles get one more
   int p = 0;
   int h = 0;
 
   auto add_card = [&] (auto card) {
       result.piles[p][h] = card;
+      result.pile_sizes[p]++;
       p++;
       if (p >= num_piles) {
         p = 0;
@@ -188,21 +360,31 @@ GameState GameState::create_random() {
     if (c1.present() && c2.present())
       std::swap(c1, c2);
   }
+  result.update_piles();
 
   return result;
 }
 
+GameState GameState::create_random(unsigned seed) {
+  // rand() has a single global state, so only one thread can deal at a time
+  static mutex random_mutex;
+  lock_guard<mutex> lock(random_mutex);
+
+  srand(seed);
+  return create_random();
+}
+
 static void move_dragons_to_done(GameState& game, int suit) {
   // check if the destination slot is already in use
   // and swap slots to free up the slot corresponding to the dragon suit
   auto dest = game.slots[suit];
-  if (dest.present() && (!dest.dragon() || dest.suit != suit)) {
+  if (dest.present() && (!dest.dragon() || dest.suit() != suit)) {
     int other = -1;
     // find another slot to swap with
     for (int i=0; i < num_suits; i++) {
       if (i != suit) {
         auto card = game.slots[i];
-        if (!card.present() || (card.dragon() && (card.suit == suit))) {
+        if (!card.present() || (card.dragon() && (card.suit() == suit))) {
           other = i;
           break;
         }
@@ -223,25 +405,22 @@ static void move_dragons_to_done(GameState& game, int suit) {
   for (int s=0; (s < num_suits) && (dragons_to_move > 0); s++) {
     if (s != suit) {
       auto card = game.slots[s];
-      if (card.dragon() && (card.suit == suit)) {
+      if (card.dragon() && (card.suit() == suit)) {
         game.slots[s] = no_card;
         dragons_to_move--;
       }
     }
   }
   for (int p=0; (p < num_piles) && (dragons_to_move > 0); p++) {
-    int h = game.pile_sizes[p]-1;
-    auto card = game.piles[p][h];
-    if (card.dragon() && (card.suit == suit)) {
-      game.piles[p][h] = no_card;
-      game.pile_sizes[p]--;
+    auto card = game.top_card_of_pile(p);
+    if (card.dragon() && (card.suit() == suit)) {
+      game.remove_cards(p, 1);
       dragons_to_move--;
     }
   }
 
   // put all of the dragons in the corresponding done slot, with value of -4
-  game.slots[suit].suit = suit;
-  game.slots[suit].value = -num_dragons;
+  game.slots[suit] = Card(suit, -num_dragons);
 }
 
 void GameState::make_move(const Move& move) {
@@ -252,8 +431,8 @@ void GameState::make_move(const Move& move) {
     if (to == move_to_done) {
       // slot to done  (according to suit)
       int s = -from-1;
-      int suit = slots[s].suit;
-      int value = slots[s].value;
+      int suit = slots[s].suit();
+      int value = slots[s].value();
       if (suit < 0) {
         blank_done += 1;
         slots[s] = no_card;
@@ -277,52 +456,38 @@ void GameState::make_move(const Move& move) {
     } else {
       // slot to pile
       int s = -from-1;
-      int h = pile_sizes[to];
-      piles[to][h] = slots[s];
-      pile_sizes[to]++;
+      add_cards(to, &slots[s], 1);
       slots[s] = no_card;
     }
   } else {
     if (to == move_to_done) {
       // pile to done  (according to suit)
       int h = pile_sizes[from]-1;
-      int suit = piles[from][h].suit;
-      int value = piles[from][h].value;
+      int suit = piles[from][h].suit();
+      int value = piles[from][h].value();
       if (suit < 0) {
         // blank card done
         blank_done += 1;
-        piles[from][h] = no_card;
-        pile_sizes[from]--;
+        remove_cards(from, 1);
       } else if (value < 0) {
         // move multiple dragons to done
         move_dragons_to_done(*this, suit);
       } else {
         // normal card to done - update value of top card in done pile
         done[suit] = value;
-        piles[from][h] = no_card;
-        pile_sizes[from]--;
+        remove_cards(from, 1);
       }
     } else if (to < 0) {
       // pile to slot
       int s = -to-1;
       int h = pile_sizes[from]-1;
       slots[s] = piles[from][h];
-      piles[from][h] = no_card;
-      pile_sizes[from]--;
+      remove_cards(from, 1);
     } else {
       // pile to pile  (moving size cards)
       int size = move.size;
-      int from_h = pile_sizes[from] - size;
-      int to_h = pile_sizes[to];
-      pile_sizes[from] -= size;
-      pile_sizes[to] += size;
-      while (size > 0) {
-        piles[to][to_h] = piles[from][from_h];
-        piles[from][from_h] = no_card;
-        from_h++;
-        to_h++;
-        size--;
-      }
+      add_cards(to, &piles[from][pile_sizes[from] - size], size);
+      remove_cards(from, size);
     }
   }
 }
@@ -333,13 +498,13 @@ static bool can_move_dragon_to_done(const GameState& game, int suit) {
 
   for (int p = 0; p < num_piles; p++) {
     auto card = game.top_card_of_pile(p);
-    if (card.dragon() && card.suit == suit)
+    if (card.dragon() && card.suit() == suit)
       dragons_showing++;
   }
 
   for (int s = 0; s < num_suits; s++) {
     auto card = game.slots[s];
-    if (card.dragon() && card.suit == suit) {
+    if (card.dragon() && card.suit() == suit) {
       dragons_showing++;
       free_slots++;  // a dragon with appropriate suit in a slot is a free slot
     }
@@ -368,18 +533,7 @@ static bool can_move_normal_to_done(const GameState& game, int suit, int value,
 }
 
 static bool can_move_card_onto_card(const Card& card, const Card& onto_card) {
-  if (!card.present()) return false;
-
-  if (!onto_card.present()) {
-    return true;  // can always place onto empty pile
-  } else if (!onto_card.normal()) {
-    return false; // can't place onto dragon or blank
-  } else if (!card.normal()) {
-    return false; // can't move dragon or blank onto another card
-  } else {
-    // ascending order of different suit
-    return (card.value == (onto_card.value - 1)) && (card.suit != onto_card.suit);
-  }
+  return card.stacks_onto(onto_card);
 }
 
 // return true if legal move, and also return whether to check higher stack sizes, when moving pile to pile
@@ -397,13 +551,14 @@ std::tuple<bool,bool> GameState::check_move(const Move& move) const {
       auto card = slots[from_slot];
       if (!card.present()) return {false, false};
       if (card.dragon_done()) return {false, false};
+      if (card.blank()) return {false, false};   // a blank card only goes to done from a pile
       if (card.dragon()) {
         // dragon to done
         if (implicit) return {false, false};
-        return {can_move_dragon_to_done(*this, card.suit), false};
+        return {can_move_dragon_to_done(*this, card.suit()), false};
       } else {
         // normal to done
-        return {can_move_normal_to_done(*this, card.suit, card.value, implicit), false};
+        return {can_move_normal_to_done(*this, card.suit(), card.value(), implicit), false};
       }
     } else {
       // pile to done
@@ -416,10 +571,10 @@ std::tuple<bool,bool> GameState::check_move(const Move& move) const {
       } else if (card.dragon()) {
         // dragon to done
         if (implicit) return {false, false};
-        return {can_move_dragon_to_done(*this, card.suit), false};
+        return {can_move_dragon_to_done(*this, card.suit()), false};
       } else {
         // normal to done
-        return {can_move_normal_to_done(*this, card.suit, card.value, implicit), false};
+        return {can_move_normal_to_done(*this, card.suit(), card.value(), implicit), false};
       }
     }
   } else if (to < 0) {
@@ -441,6 +596,7 @@ std::tuple<bool,bool> GameState::check_move(const Move& move) const {
     int from_slot = -from-1;
     auto card = slots[from_slot];
     if (card.dragon_done()) return {false, false};
+    if (pile_sizes[to] >= max_pile_size) return {false, false};
     auto onto_card = top_card_of_pile(to);
     return {can_move_card_onto_card(card, onto_card), false};
   } else {
@@ -448,17 +604,15 @@ std::tuple<bool,bool> GameState::check_move(const Move& move) const {
     if (implicit) return {false, false};
     auto onto_card = top_card_of_pile(to);
 
-    // size can be 1 or more.  check the bottom card of the given stack
-    if (size < 1) return {false, false};
-    int h = pile_sizes[from]-size;
-    if (h < 0) return {false, false};
-    auto card = piles[from][h];
+    // size can be 1 or more, up to the run at the top of the pile.  check the bottom card of the given stack
+    if (size < 1 || size > run_lengths[from]) return {false, false};
+    if (pile_sizes[to] + size > max_pile_size) return {false, false};
+    auto card = piles[from][pile_sizes[from]-size];
 
     bool legal = can_move_card_onto_card(card, onto_card);
 
-    // if next card forms an ascending sequence of alternating suits, then that's another move to try, using the same from/to
-    auto next_card = (h > 0) ? piles[from][h-1] : no_card;
-    bool try_next_size = card.normal() && next_card.normal() && (next_card.suit != card.suit) && (next_card.value == card.value + 1);
+    // if the run is longer, then that's another move to try, using the same from/to
+    bool try_next_size = size < run_lengths[from];
 
     return {legal, try_next_size};
   }
@@ -485,10 +639,11 @@ bool GameState::normalize() {
   sort(begin(pile_indexes), end(pile_indexes),
       [&] (int l, int r) {
     if (pile_sizes[l] != pile_sizes[r]) return (pile_sizes[l] < pile_sizes[r]);
-    auto top_l = this->top_card_of_pile(l);
-    auto top_r = this->top_card_of_pile(r);
-    bool result = top_l < top_r;
-    return result;
+    // compare cards from the top down, so that piles only tie when they are identical
+    for (int h = pile_sizes[l]-1; h >= 0; h--) {
+      if (piles[l][h] != piles[r][h]) return (piles[l][h] < piles[r][h]);
+    }
+    return false;
   });
 
   // check if changed
@@ -508,10 +663,12 @@ bool GameState::normalize() {
     for (int p=0; p < num_piles; p++) {
       int from_p = pile_indexes[p];
       pile_sizes[p] = orig.pile_sizes[from_p];
+      run_lengths[p] = orig.run_lengths[from_p];
       for (int h=0; h < orig.pile_sizes[from_p]; h++) {
         piles[p][h] = orig.piles[from_p][h];
       }
     }
+    index_tops();
     for (int s=0; s < num_suits; s++) {
       int from_s = slot_indexes[s];
       slots[s] = orig.slots[from_s];
@@ -521,30 +678,58 @@ bool GameState::normalize() {
   return changed;
 }
 
-static WinResult solve_game_recursive(const GameState& state, vector<Move>& moves_to_win, unordered_set<GameState>& visited_states, int depth, int max_states, int max_depth) {
-  // Base case - we found a winning state!
-  if (state.win())
-    return WinResult::WIN;
+// make every implicit move in turn, until there are none left.  these moves are always safe to make,
+// so the search can treat them as part of the move that exposed them, rather than as separate states.
+// the moves made are appended in order, and the number of moves is returned
+int GameState::apply_safe_moves(vector<Move>& moves) {
+  int count = 0;
+  int from = -num_suits;
 
-  // DEBUG: stop after N visits
-  if (visited_states.size() >= max_states) {
-//    cout << "Max states reached: " << visited_states.size() << endl;
-    return WinResult::MAX;
-  }
-  if (depth >= max_depth) {
-//    cout << "Max depth reached: " << depth << endl;
-    return WinResult::MAX;
+  while (from < num_piles) {
+    Move move(from, move_to_done, 1, true);
+    auto [legal, try_next_size] = check_move(move);
+
+    if (legal) {
+      make_move(move);
+      moves.push_back(move);
+      count++;
+      from = -num_suits;  // start over, since this may have made an earlier move legal
+    } else {
+      from++;
+    }
   }
 
-  // Create a copy of the state, in normalized form
-  GameState normalized_state = state;
-  normalized_state.normalize();
+  return count;
+}
 
-  // Check if we have already visited this normalized state, to avoid loops
-  if (visited_states.find(normalized_state) != visited_states.end()) {
-    return WinResult::LOOP;
+// collect the moves to try from the given state, in the same order as the solvers step through them.
+// if any implicit move is legal, only the first one is returned, since it is forced, unless all_legal is set.
+void generate_moves(const GameState& game, vector<Move>& moves, bool all_legal) {
+  moves.clear();
+
+  // Moves to different empty slots, or to different empty piles, reach the same normalized state,
+  // so only the first empty slot and the first empty pile are tried as destinations
+  int empty_slot = 0;
+  int empty_pile = num_piles;
+  if (!all_legal) {
+    for (int s = num_suits-1; s >= 0; s--) {
+      if (!game.slots[s].present()) {
+        empty_slot = -s-1;
+        break;
+      }
+    }
+    for (int p = 0; p < num_piles; p++) {
+      if (game.pile_sizes[p] == 0) {
+        empty_pile = p;
+        break;
+      }
+    }
   }
-  visited_states.insert(normalized_state);
+
+  // Moves onto piles are all checked at once, the first time the loop reaches them
+  PileMoves pile_moves;
+  PileMask slot_destinations[num_suits];
+  bool found_pile_moves = false;
 
   // Counters to loop through each next move
   bool implicit = true;
@@ -552,14 +737,38 @@ static WinResult solve_game_recursive(const GameState& state, vector<Move>& move
   int to = move_to_done;
   int size = 1;
 
-  int move_count = 0;
-
-  // Try each next move in turn
   while (1) {
     Move move(from, to, size, implicit);
 
     // Check if move is legal, and whether we should also check further stack sizes
-    auto [legal, try_next_size] = state.check_move(move);
+    bool legal, try_next_size;
+    if (to >= 0 && !implicit) {
+      if (!found_pile_moves) {
+        find_pile_moves(game, pile_moves);
+        for (int s = 0; s < num_suits; s++) {
+          slot_destinations[s] = game.slots[s].dragon_done() ? 0 : game.destinations(game.slots[s]);
+        }
+        found_pile_moves = true;
+      }
+      if (from >= 0) {
+        legal = (pile_moves.masks[size-1][from] >> to) & 1;
+        try_next_size = size < pile_moves.run_lengths[from];
+      } else {
+        legal = (slot_destinations[-from-1] >> to) & 1;
+        try_next_size = false;
+      }
+    } else {
+      tie(legal, try_next_size) = game.check_move(move);
+    }
+
+    bool redundant = !all_legal && (to != move_to_done) &&
+      ((to < 0) ? (to != empty_slot) : (to > empty_pile && game.pile_sizes[to] == 0));
+
+    if (legal && !redundant) {
+      moves.push_back(move);
+      if (implicit && !all_legal)
+        break;
+    }
 
     // Iterate through each move one at a time, first checking all implicit moves
     // from:  slots, piles
@@ -577,7 +786,7 @@ static WinResult solve_game_recursive(const GameState& state, vector<Move>& move
       to = move_to_done;
       size = 1;
       if (from >= num_piles) {
-        if (implicit) {
+        if (implicit && (all_legal || moves.empty())) {
           implicit = false;
           from = -num_suits;
         }
@@ -589,22 +798,236 @@ static WinResult solve_game_recursive(const GameState& state, vector<Move>& move
       to += 1;
       size = 1;
     }
+  }
+}
+
+// whether the move leaves the card below it at the top of its pile, ready to be moved to done implicitly
+static bool exposes_implicit_move(const GameState& game, const Move& move) {
+  if (move.from < 0) return false;
+  int h = game.pile_sizes[move.from] - move.size - 1;
+  if (h < 0) return false;
+
+  auto card = game.piles[move.from][h];
+  if (card.blank()) return true;
+  if (!card.normal()) return false;
+  return can_move_normal_to_done(game, card.suit(), card.value(), true);
+}
+
+static bool moves_disjoint(const Move& a, const Move& b) {
+  if (a.implicit || b.implicit) return false;
+  if (a.to == move_to_done || b.to == move_to_done) return false;
+  return (a.from != b.from) && (a.from != b.to) && (a.to != b.from) && (a.to != b.to);
+}
+
+// two legal explicit moves commute if they touch different piles and slots, and neither one goes to done
+// or exposes a card that would be forced to done.  then making them in either order reaches the same state
+bool moves_commute(const GameState& game, const Move& a, const Move& b) {
+  return moves_disjoint(a, b) && !exposes_implicit_move(game, a) && !exposes_implicit_move(game, b);
+}
+
+// find a legal move from the given state that reaches the target, up to normalization.
+// this is used to replay a line of normalized states using the actual pile and slot positions.
+// every legal move is considered, since which implicit move comes first depends on the pile order
+bool find_move_to(const GameState& game, const GameState& normalized_target, Move& move) {
+  vector<Move> moves;
+  generate_moves(game, moves, true);
+
+  for (auto& m : moves) {
+    GameState next_state = game;
+    next_state.make_move(m);
+    next_state.normalize();
+    if (next_state == normalized_target) {
+      move = m;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Everything shared across one depth-first search
+struct DfsSearch {
+  unordered_set<GameState> visited_states;
+  SolveOptions options;
+  int max_depth;
+  int best_cards_done;        // most cards done on any state reached so far
+  size_t states_searched;
+  bool gave_up;               // whether any line was cut short by a limit
+  bool stopped = false;       // whether the whole search was cut short
+  bool loss_proven = false;   // set along with each LOSE result:  whether the state is lost, rather than only having lines cut short by loops
+
+  // for checkpoints:  the deal, the normalized states on the line being searched, and time spent before this run
+  const GameState* game = nullptr;
+  vector<const GameState*> line;
+  double previous_seconds = 0;
+  chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+  chrono::steady_clock::time_point last_checkpoint = start_time;
+
+  WinResult give_up() {
+    gave_up = true;
+    return WinResult::MAX;
+  }
+
+  void save_checkpoint() {
+    DfsCheckpoint checkpoint;
+    checkpoint.states_searched = states_searched;
+    checkpoint.best_cards_done = best_cards_done;
+    checkpoint.seconds = previous_seconds + chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    if (!write_checkpoint(options.checkpoint_path, *game, max_depth, checkpoint, line, visited_states))
+      cout << "Can't write checkpoint " << options.checkpoint_path << endl;
+    last_checkpoint = chrono::steady_clock::now();
+  }
+
+  // stopping the whole search saves the line being searched, before the search unwinds
+  WinResult stop() {
+    if (!stopped && !options.checkpoint_path.empty())
+      save_checkpoint();
+    stopped = true;
+    return give_up();
+  }
+};
+
+// keeps DfsSearch::line up to date as the search goes in and out of each state
+class DfsLineEntry {
+public:
+  DfsLineEntry(DfsSearch& search, const GameState* state) : search(search) { search.line.push_back(state); }
+  ~DfsLineEntry() { search.line.pop_back(); }
+
+private:
+  DfsSearch& search;
+};
+
+// sleep_moves are legal moves that commute with the moves leading here, and were already searched in the other order,
+// so they can be skipped without generating their states.  this is partial-order reduction using sleep sets
+static WinResult solve_game_recursive(DfsSearch& search, const GameState& state, vector<Move>& moves_to_win, int depth, const vector<Move>& sleep_moves) {
+  auto& visited_states = search.visited_states;
+
+  // Base case - we found a winning state!
+  // forced moves can take several moves at once, so this can be reached past the depth limit
+  if (state.win())
+    return (depth <= search.max_depth) ? WinResult::WIN : search.give_up();
+
+  // DEBUG: stop after N visits
+  if (visited_states.size() >= search.options.max_states) {
+//    cout << "Max states reached: " << visited_states.size() << endl;
+    return search.stop();
+  }
+  if (depth >= search.max_depth) {
+//    cout << "Max depth reached: " << depth << endl;
+    return search.give_up();
+  }
+  if (search.options.cancel && *search.options.cancel)
+    return search.stop();
+  if (chrono::steady_clock::now() >= search.options.deadline)
+    return search.stop();
+
+  // Near the end of the game, look up the answer instead of searching for it
+  if (search.options.tablebase && cards_left(state) <= search.options.tablebase->max_cards()) {
+    int distance = search.options.tablebase->probe(state);
+    if (distance == Tablebase::lose) {
+      search.loss_proven = true;
+      return WinResult::LOSE;
+    }
+    if (distance >= 0) {
+      if (depth + distance > search.max_depth)
+        return search.give_up();
+
+      vector<Move> endgame_moves;
+      if (search.options.tablebase->moves_to_win(state, endgame_moves)) {
+        moves_to_win.insert(moves_to_win.end(), endgame_moves.rbegin(), endgame_moves.rend());
+        return WinResult::WIN;
+      }
+    }
+  }
+
+  // Finish along a line already known to win, such as one found by an earlier search of the same game
+  if (search.options.solutions) {
+    int distance = search.options.solutions->distance(state);
+    if (distance >= 0) {
+      if (depth + distance > search.max_depth)
+        return search.give_up();
+
+      vector<Move> known_moves;
+      if (search.options.solutions->moves_to_win(state, known_moves)) {
+        moves_to_win.insert(moves_to_win.end(), known_moves.rbegin(), known_moves.rend());
+        return WinResult::WIN;
+      }
+    }
+    if (search.options.solutions->is_loss(state)) {
+      search.loss_proven = true;
+      return WinResult::LOSE;
+    }
+  }
 
-    // Only proceed with legal moves
-    if (!legal)
+  // Create a copy of the state, in normalized form
+  GameState normalized_state = state;
+  normalized_state.normalize();
+
+  // Check if we have already visited this normalized state, to avoid loops
+  if (visited_states.find(normalized_state) != visited_states.end()) {
+    return WinResult::LOOP;
+  }
+  visited_states.insert(normalized_state);
+  search.states_searched++;
+  DfsLineEntry line_entry(search, &normalized_state);
+
+  if (!search.options.checkpoint_path.empty() && search.states_searched % 4096 == 0 &&
+      chrono::steady_clock::now() - search.last_checkpoint >= chrono::seconds(search.options.checkpoint_seconds))
+    search.save_checkpoint();
+
+  // If the state can be proven unwinnable without searching, leave it in visited_states as a loss
+  if (is_dead_state(state)) {
+    search.loss_proven = true;
+    return WinResult::LOSE;
+  }
+
+  search.best_cards_done = max(search.best_cards_done, cards_done(state));
+
+  vector<Move> moves;
+  generate_moves(state, moves);
+  if (search.options.ordering)
+    search.options.ordering->order_moves(state, moves, depth);
+
+  // Explicit moves already searched from this state, which don't need to be searched again below a commuting move
+  vector<Move> explored_moves;
+  vector<Move> next_sleep_moves;
+  vector<Move> safe_moves;
+
+  // Whether every move has been shown to lose, so that this state is lost too
+  bool all_lost = true;
+
+  // Try each next move in turn
+  for (auto& move : moves) {
+    // Skip moves that were already searched from an earlier state, in the other order
+    if (find(sleep_moves.begin(), sleep_moves.end(), move) != sleep_moves.end()) {
+      all_lost = false;
       continue;
+    }
 
-    move_count++;
+    // Moves that commute with this one stay asleep in the next state
+    next_sleep_moves.clear();
+    for (auto& sleep_move : sleep_moves) {
+      if (moves_commute(state, sleep_move, move))
+        next_sleep_moves.push_back(sleep_move);
+    }
+    for (auto& explored_move : explored_moves) {
+      if (moves_commute(state, explored_move, move))
+        next_sleep_moves.push_back(explored_move);
+    }
 
-    // Make the move on a copy of the game state
+    // Make the move on a copy of the game state, followed by any moves that are then forced
     GameState next_state = state;
     next_state.make_move(move);
+    safe_moves.clear();
+    next_state.apply_safe_moves(safe_moves);
 
     // Recursively check the state after making this move
-    WinResult result = solve_game_recursive(next_state, moves_to_win, visited_states, depth+1, max_states, max_depth);
+    int prev_best_cards_done = search.best_cards_done;
+    WinResult result = solve_game_recursive(search, next_state, moves_to_win, depth+1+safe_moves.size(), next_sleep_moves);
 
     if (result == WinResult::WIN) {
       // Found a winning line, append this move to the result as we unwind the stack
+      moves_to_win.insert(moves_to_win.end(), safe_moves.rbegin(), safe_moves.rend());
       moves_to_win.push_back(move);
 
       // Also remove all normalized states that were reached as part of a non-losing line,
@@ -612,26 +1035,72 @@ static WinResult solve_game_recursive(const GameState& state, vector<Move>& move
       visited_states.erase(normalized_state);
 
       return result;
-    } else if (implicit) {
+    } else if (move.implicit) {
       // If we tried an implicit move that resulted in anything but a win, then this entire line can't be solved for the same reason
 
       if (result != WinResult::LOSE) {
         // Also remove all normalized states that were reached as part of a non-losing line,
         // so that visited_states only contains states to ignore on future searches
         visited_states.erase(normalized_state);
+      } else if (search.loss_proven && search.options.solutions) {
+        search.options.solutions->add_loss(normalized_state);
       }
 
       return result;
     }
+
+    if (result != WinResult::LOSE || !search.loss_proven)
+      all_lost = false;
+
+    if (search.options.ordering)
+      search.options.ordering->move_searched(state, move, depth, search.best_cards_done > prev_best_cards_done);
+
+    explored_moves.push_back(move);
   }
 
   // No more legal moves, or all legal moves from this state result in a loss
+  if (all_lost && search.options.solutions)
+    search.options.solutions->add_loss(normalized_state);
+  search.loss_proven = all_lost;
   return WinResult::LOSE;
 }
 
-bool solve_game_dfs(const GameState& game, std::vector<Move>& moves_to_win, int max_depth) {
-  unordered_set<GameState> visited_states;
-  WinResult result = solve_game_recursive(game, moves_to_win, visited_states, 0, 10000000, max_depth);
+bool solve_game_dfs(const GameState& game, std::vector<Move>& moves_to_win, int max_depth, const SolveOptions& options) {
+  DfsSearch search{{}, options, max_depth, 0, 0, false};
+  search.game = &game;
+
+  if (options.resume && !options.checkpoint_path.empty()) {
+    DfsCheckpoint checkpoint;
+    if (read_checkpoint(options.checkpoint_path, game, max_depth, checkpoint, search.visited_states)) {
+      search.states_searched = checkpoint.states_searched;
+      search.best_cards_done = checkpoint.best_cards_done;
+      search.previous_seconds = checkpoint.seconds;
+      cout << "Resuming from checkpoint with " << search.visited_states.size() << " states after " << checkpoint.seconds << " seconds" << endl;
+    } else {
+      cout << "No checkpoint to resume from in " << options.checkpoint_path << endl;
+    }
+  }
+
+  // Start from the state after any forced moves
+  GameState start = game;
+  vector<Move> safe_moves;
+  start.apply_safe_moves(safe_moves);
+
+  WinResult result = solve_game_recursive(search, start, moves_to_win, safe_moves.size(), {});
+  if (result == WinResult::WIN) {
+    moves_to_win.insert(moves_to_win.end(), safe_moves.rbegin(), safe_moves.rend());
+  }
+
+  if (options.stats) {
+    options.stats->result = (result == WinResult::WIN) ? WinResult::WIN : search.gave_up ? WinResult::MAX : WinResult::LOSE;
+    options.stats->loss_proven = (options.stats->result == WinResult::LOSE) && search.loss_proven;
+    options.stats->states_searched = search.states_searched;
+  }
+
+  // a finished search has nothing left to resume
+  if (!options.checkpoint_path.empty() && !search.stopped)
+    remove(options.checkpoint_path.c_str());
+
   return result == WinResult::WIN;
 }
 
@@ -639,12 +1108,14 @@ bool solve_game_bfs(const GameState& game, vector<Move>& moves_to_win) {
   unordered_set<GameState> visited_states;
   vector<tuple<Move, int, int>> all_moves;
   queue<pair<GameState, int>> states_to_visit;
-  unordered_set<GameState> lookahead_states;
+  DfsSearch lookahead{{}, SolveOptions(), 500, 0, 0, false};
 
   states_to_visit.emplace(game, -1);
 
   int prev_depth = -1;
-  int max_depth = 500;
+  int& max_depth = lookahead.max_depth;
+
+  vector<Move> moves;
 
   while (!states_to_visit.empty()) {
     auto [state, prev_move_index] = states_to_visit.front();
@@ -662,61 +1133,20 @@ bool solve_game_bfs(const GameState& game, vector<Move>& moves_to_win) {
     // Every so often, check if this state can be solved at all, using depth-first-search
     if (depth % 3 == 0) {
       vector<Move> lookahead_moves;
-      WinResult result = solve_game_recursive(state, lookahead_moves, lookahead_states, depth, 10000000, max_depth);
+      WinResult result = solve_game_recursive(lookahead, state, lookahead_moves, depth, {});
       if (result == WinResult::WIN) {
-        cout << "YES - solution with " << lookahead_moves.size() << " moves, lookahead_states: " << lookahead_states.size() << endl;
+        cout << "YES - solution with " << lookahead_moves.size() << " moves, lookahead_states: " << lookahead.visited_states.size() << endl;
         max_depth = lookahead_moves.size();
       } else {
-        cout << "NO - lookahead_states: " << lookahead_states.size() << " result: " << magic_enum::enum_name(result) << endl;
+        cout << "NO - lookahead_states: " << lookahead.visited_states.size() << " result: " << magic_enum::enum_name(result) << endl;
         continue;
       }
     }
 
-    // Counters to loop through each next move
-    bool implicit = true;
-    int from = -num_suits;
-    int to = move_to_done;
-    int size = 1;
+    generate_moves(state, moves);
 
     // Try each next move in turn
-    while (1) {
-      Move move(from, to, size, implicit);
-
-      // Check if move is legal, and whether we should also check further stack sizes
-      auto [legal, try_next_size] = state.check_move(move);
-
-      // Iterate through each move one at a time, first checking all implicit moves
-      // from:  slots, piles
-      // to:    done, piles, slots
-      if (try_next_size) {
-        size += 1;
-      } else if (to == move_to_done) {
-        to = 0;
-        size = 1;
-      } else if (to >= num_piles-1) {
-        to = -num_suits;
-        size = 1;
-      } else if (to == -1) {
-        from += 1;
-        to = move_to_done;
-        size = 1;
-        if (from >= num_piles) {
-          if (implicit) {
-            implicit = false;
-            from = -num_suits;
-          }
-          else
-            break;  // done looping
-        }
-      } else {
-        to += 1;
-        size = 1;
-      }
-
-      // Only proceed with legal moves
-      if (!legal)
-        continue;
-
+    for (auto& move : moves) {
       // Make the move on a copy of the game state
       GameState next_state = state;
       next_state.make_move(move);
@@ -743,14 +1173,14 @@ bool solve_game_bfs(const GameState& game, vector<Move>& moves_to_win) {
       }
       visited_states.insert(normalized_state);
 
+      // Don't bother visiting states that can be proven unwinnable
+      if (is_dead_state(next_state))
+        continue;
+
       // Add the new state and the move it took to get here
       int move_index = all_moves.size();
       all_moves.emplace_back(move, prev_move_index, depth+1);
       states_to_visit.emplace(next_state, move_index);
-
-      // Only add one legal implicit move from this state
-      if (implicit)
-        break;
     }
   }
 
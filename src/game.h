@@ -2,20 +2,56 @@
 
 #include <iostream>
 #include <vector>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <type_traits>
 
 #include "card.h"
 #include "move.h"
 
-const int num_suits = 3;
-const int num_piles = 8;
-const int max_value = 9;
-const int num_dragons = 4;
-const int num_blanks = 1;
+const int num_piles = Rules::num_piles;
+const int num_blanks = Rules::num_blanks;
 
 const int init_pile_size = ((max_value * num_suits) + (num_dragons * num_suits) + num_blanks + (num_piles - 1)) / num_piles;
 const int max_pile_size = init_pile_size + (max_value - 2);
 const int move_to_done = -999;
 
+// bitmask with a bit for each pile
+typedef std::conditional_t<(num_piles <= 8), uint8_t, uint16_t> PileMask;
+
+static_assert(num_piles <= 16, "piles are indexed by the bits of a PileMask");
+
+const int max_cards = (max_value * num_suits) + (num_dragons * num_suits) + num_blanks;
+const int packed_state_size = num_piles + max_cards + (num_suits * 2) + 1;
+
+// fixed-size byte encoding of a game state, suitable for sorting and storing on disk
+typedef std::array<uint8_t, packed_state_size> PackedState;
+
+// the rules a file was written under.  every file stored on disk has it in its header, so that a build for another
+// variant refuses to load it
+struct RulesSignature {
+  uint8_t  num_piles;
+  uint8_t  num_suits;
+  uint8_t  max_value;
+  uint8_t  num_dragons;
+  uint8_t  num_blanks;
+  uint8_t  padding;
+  uint16_t packed_state_size;
+
+  static constexpr RulesSignature current() {
+    return {::num_piles, ::num_suits, ::max_value, ::num_dragons, ::num_blanks, 0, ::packed_state_size};
+  }
+
+  bool matches_current() const {
+    auto rules = current();
+    return num_piles == rules.num_piles && num_suits == rules.num_suits && max_value == rules.max_value &&
+      num_dragons == rules.num_dragons && num_blanks == rules.num_blanks && packed_state_size == rules.packed_state_size;
+  }
+};
+
 enum class WinResult { WIN, LOSE, LOOP, MAX };
 
 class GameState {
@@ -30,17 +66,40 @@ public:
   int  done[num_suits];                     // nonzero indicates top card value for the corresponding suit
   int  blank_done;                          // count of blank cards moved to the blank slot (0 or 1)
 
+  // kept up to date by make_move, from the piles above.  anything else that changes the piles calls update_piles
+  int8_t  run_lengths[num_piles];           // cards in the run of descending alternating suits at the top of each pile
+  PileMask piles_by_top[max_value+1][num_suits];  // the piles with each normal card on top, by value and suit
+  PileMask empty_piles;                     // the empty piles
+
   bool win() const;
   std::tuple<bool,bool> check_move(const Move& move) const;
   const Card& top_card_of_pile(int pile) const;
+  const Card& run_bottom(int pile) const;   // bottom card of the run at the top of the pile
+  PileMask destinations(const Card& card) const;  // the piles the card can be placed onto
 
   void make_move(const Move& move);
+  int apply_safe_moves(std::vector<Move>& moves);
+  void update_piles();                      // recomputes the run lengths and indexes of every pile
+
+  PackedState pack() const;
+  static GameState unpack(const PackedState& packed);
 
   static GameState create_random();
+  static GameState create_random(unsigned seed);  // same deal as srand(seed) then create_random(), and safe to call from any thread
 
   friend std::ostream& operator<<(std::ostream& os, const GameState& game);
   friend bool operator==(const GameState& g1, const GameState& g2);
   friend bool operator!=(const GameState& g1, const GameState& g2);
+
+  // move cards off the top of a pile, or onto it, keeping its run length and indexes up to date.
+  // cards added more than one at a time must already be a run
+  void remove_cards(int pile, int count);
+  void add_cards(int pile, const Card* cards, int count);
+
+private:
+  void index_top(int pile, bool add);
+  void index_tops();
+  void scan_run(int pile);
 };
 
 template <> class std::hash<GameState> {
@@ -48,5 +107,39 @@ public:
   size_t operator()(const GameState& g) const;
 };
 
-bool solve_game_dfs(const GameState& game, std::vector<Move>& moves_to_win, int max_depth);
+class PackedStateHash {
+public:
+  size_t operator()(const PackedState& p) const;
+};
+
+void generate_moves(const GameState& game, std::vector<Move>& moves, bool all_legal = false);
+bool find_move_to(const GameState& game, const GameState& normalized_target, Move& move);
+bool moves_commute(const GameState& game, const Move& a, const Move& b);
+
+class MoveOrdering;
+class Tablebase;
+class SolutionTree;
+
+// what happened during a search, filled in when requested
+struct SolveStats {
+  WinResult result = WinResult::LOSE;   // LOSE when every line was searched, MAX when the search gave up
+  bool loss_proven = false;             // with LOSE:  whether the game is lost, rather than only having lines cut short by loops
+  size_t states_searched = 0;
+};
+
+// optional settings for the depth-first solver
+struct SolveOptions {
+  MoveOrdering* ordering = nullptr;   // order to try moves in, or null for the order they're generated
+  int max_states = 10000000;          // give up after visiting this many states
+  const Tablebase* tablebase = nullptr;  // endgame table to look up states near the end, if any
+  SolutionTree* solutions = nullptr;  // known winning lines to finish along when the search reaches one, if any.  proven losses are added to it
+  const std::atomic<bool>* cancel = nullptr;  // stops the search early once set
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();  // gives up after this time
+  SolveStats* stats = nullptr;        // filled in at the end of the search, if given
+  std::string checkpoint_path;        // saves the search's progress to this file every checkpoint_seconds, if set
+  int checkpoint_seconds = 300;
+  bool resume = false;                // carries on from the checkpoint file, if there's one for this deal
+};
+
+bool solve_game_dfs(const GameState& game, std::vector<Move>& moves_to_win, int max_depth, const SolveOptions& options = SolveOptions());
 bool solve_game_bfs(const GameState& game, std::vector<Move>& moves_to_win);
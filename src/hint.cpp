@@ -0,0 +1,39 @@
+#include "hint.h"
+#include "tablebase.h"
+
+using namespace std;
+
+HintEngine::HintEngine(const Tablebase* tablebase, int max_depth) : session(max_depth), tablebase(tablebase) {
+}
+
+HintEngine::Result HintEngine::hint(const GameState& game, Move& move, chrono::milliseconds budget) {
+  auto deadline = chrono::steady_clock::now() + budget;
+
+  if (game.win())
+    return Result::WON;
+
+  // a known line is the quickest answer, then an endgame in the tablebase
+  if (session.solutions().next_move(game, move))
+    return Result::MOVE;
+  vector<Move> moves;
+  if (tablebase && tablebase->moves_to_win(game, moves)) {
+    move = moves.front();
+    return Result::MOVE;
+  }
+  if (tablebase && tablebase->probe(game) == Tablebase::lose)
+    return Result::UNWINNABLE;
+
+  SolveStats stats;
+  SolveOptions options;
+  options.ordering = &ordering;
+  options.tablebase = tablebase;
+  options.deadline = deadline;
+  options.stats = &stats;
+
+  vector<Move> moves_to_win;
+  if (session.solve(game, moves_to_win, options)) {
+    move = moves_to_win.back();
+    return Result::MOVE;
+  }
+  return (stats.result == WinResult::LOSE) ? Result::UNWINNABLE : Result::TIMEOUT;
+}
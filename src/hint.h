@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+
+#include "game.h"
+#include "move_order.h"
+#include "session.h"
+
+class Tablebase;
+
+// Hints for one game, as it's played:  the next move on a winning line from whatever state it's in.
+//
+// Hints come from a solve session, which answers at once while the player stays on a known line, and otherwise
+// rejoins one or searches from the state until the latency budget runs out.  Move ordering history is also kept
+// between hints.  Not thread safe:  use one engine per game being played.
+class HintEngine {
+public:
+  enum class Result {
+    MOVE,        // move is the next move on a winning line
+    WON,         // the game is already won
+    UNWINNABLE,  // no line from the state wins
+    TIMEOUT,     // the budget ran out before a winning line was found
+  };
+
+  HintEngine(const Tablebase* tablebase = nullptr, int max_depth = 1000);
+
+  Result hint(const GameState& game, Move& move, std::chrono::milliseconds budget);
+
+  const SolutionTree& solutions() const { return session.solutions(); }
+
+private:
+  SolveSession session;
+  HeuristicMoveOrdering ordering;
+  const Tablebase* tablebase;
+};
@@ -1,17 +1,321 @@
 #include "game.h"
+#include "external_bfs.h"
+#include "parallel_bfs.h"
+#include "move_order.h"
+#include "tablebase.h"
+#include "best_first.h"
+#include "beam.h"
+#include "portfolio.h"
+#include "anytime.h"
+#include "shortener.h"
+#include "verify.h"
+#include "solution_cache.h"
+#include "hint.h"
+#include "estimate.h"
+#include "rating.h"
+#include "solvable_deal.h"
+#include "playout.h"
+#include "magic_enum.hpp"
 #include "time.h"
 
+#include <algorithm>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <string>
+
 using namespace std;
 
+// set when the process is asked to stop, so a search with a checkpoint can save its progress first
+static atomic<bool> interrupted(false);
+
+static void handle_interrupt(int) {
+  interrupted = true;
+}
+
 int main(int argc, const char *argv[]) {
-  if (argc < 2) {
-    cout << "Usage: solitaire <seed> [max_depth]" << endl;
+  // separate options from positional arguments
+  vector<const char*> args;
+  const char* external_bfs_dir = nullptr;
+  int parallel_bfs_threads = -1;
+  string order = "generated";
+  const char* tablebase_path = nullptr;
+  const char* make_tablebase_path = nullptr;
+  int make_tablebase_cards = 0;
+  bool best_first = false;
+  int beam_width = 0;
+  int triage_playouts = 0;
+  double triage_rate = 0;
+  const char* pattern_db_path = nullptr;
+  const char* make_pattern_db_path = nullptr;
+  string combine = "max";
+  double portfolio_seconds = -1;
+  double anytime_seconds = -1;
+  bool shorten = false;
+  const char* verify_path = nullptr;
+  const char* record_path = nullptr;
+  int threads = 0;
+  const char* cache_path = nullptr;
+  const char* checkpoint_path = nullptr;
+  bool resume = false;
+  const char* hint_state = nullptr;
+  int hint_milliseconds = 0;
+  bool estimate = false;
+  SolvabilityOptions estimate_options;
+  const char* rating_path = nullptr;
+  unsigned rating_first_seed = 0;
+  unsigned rating_last_seed = 0;
+  RatingOptions rating_options;
+  const char* generate_path = nullptr;
+  unsigned generate_seed = 0;
+  int generate_count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--external-bfs" && i+1 < argc) {
+      external_bfs_dir = argv[++i];
+    } else if (arg == "--parallel-bfs" && i+1 < argc) {
+      parallel_bfs_threads = atoi(argv[++i]);
+    } else if (arg == "--order" && i+1 < argc) {
+      order = argv[++i];
+    } else if (arg == "--tablebase" && i+1 < argc) {
+      tablebase_path = argv[++i];
+    } else if (arg == "--make-tablebase" && i+2 < argc) {
+      make_tablebase_path = argv[++i];
+      make_tablebase_cards = atoi(argv[++i]);
+    } else if (arg == "--best-first") {
+      best_first = true;
+    } else if (arg == "--beam" && i+1 < argc) {
+      beam_width = atoi(argv[++i]);
+    } else if (arg == "--triage" && i+2 < argc) {
+      triage_playouts = atoi(argv[++i]);
+      triage_rate = atof(argv[++i]);
+    } else if (arg == "--pattern-db" && i+1 < argc) {
+      pattern_db_path = argv[++i];
+    } else if (arg == "--combine" && i+1 < argc) {
+      combine = argv[++i];
+    } else if (arg == "--portfolio" && i+1 < argc) {
+      portfolio_seconds = atof(argv[++i]);
+    } else if (arg == "--anytime" && i+1 < argc) {
+      anytime_seconds = atof(argv[++i]);
+    } else if (arg == "--shorten") {
+      shorten = true;
+    } else if (arg == "--verify" && i+1 < argc) {
+      verify_path = argv[++i];
+    } else if (arg == "--record" && i+1 < argc) {
+      record_path = argv[++i];
+    } else if (arg == "--threads" && i+1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (arg == "--cache" && i+1 < argc) {
+      cache_path = argv[++i];
+    } else if (arg == "--checkpoint" && i+1 < argc) {
+      checkpoint_path = argv[++i];
+    } else if (arg == "--resume") {
+      resume = true;
+    } else if (arg == "--hint" && i+2 < argc) {
+      hint_state = argv[++i];
+      hint_milliseconds = atoi(argv[++i]);
+    } else if (arg == "--estimate" && i+2 < argc) {
+      estimate = true;
+      estimate_options.first_seed = strtoul(argv[++i], nullptr, 10);
+      estimate_options.last_seed = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--precision" && i+1 < argc) {
+      estimate_options.precision = atof(argv[++i]);
+    } else if (arg == "--budget" && i+2 < argc) {
+      estimate_options.max_states = rating_options.max_states = atoi(argv[++i]);
+      estimate_options.max_time = rating_options.max_time = chrono::milliseconds(atoi(argv[++i]));
+    } else if (arg == "--rate" && i+3 < argc) {
+      rating_first_seed = strtoul(argv[++i], nullptr, 10);
+      rating_last_seed = strtoul(argv[++i], nullptr, 10);
+      rating_path = argv[++i];
+    } else if (arg == "--generate" && i+3 < argc) {
+      generate_seed = strtoul(argv[++i], nullptr, 10);
+      generate_count = atoi(argv[++i]);
+      generate_path = argv[++i];
+    } else if (arg == "--make-pattern-db" && i+1 < argc) {
+      make_pattern_db_path = argv[++i];
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  if (make_tablebase_path) {
+    bool result = generate_tablebase(make_tablebase_path, make_tablebase_cards);
+    cout << (result ? "Tablebase written" : "Tablebase failed") << endl;
+    return result ? 0 : 1;
+  }
+
+  if (make_pattern_db_path) {
+    bool result = generate_pattern_database(make_pattern_db_path);
+    cout << (result ? "Pattern database written" : "Pattern database failed") << endl;
+    return result ? 0 : 1;
+  }
+
+  if (verify_path) {
+    ifstream in(verify_path);
+    if (!in) {
+      cout << "Can't open " << verify_path << endl;
+      return 1;
+    }
+    size_t num_verified = 0;
+    size_t failures = verify_solutions(in, cout, threads, &num_verified);
+    cout << "Verified " << num_verified << " solutions, " << failures << " failed" << endl;
+    return failures ? 1 : 0;
+  }
+
+  if (estimate) {
+    Tablebase tablebase;
+    if (tablebase_path && !tablebase.open(tablebase_path)) {
+      cout << "Can't open tablebase " << tablebase_path << endl;
+      return 1;
+    }
+    estimate_options.tablebase = tablebase_path ? &tablebase : nullptr;
+    SolutionCache cache;
+    if (cache_path && !cache.open(cache_path)) {
+      cout << "Can't open cache " << cache_path << endl;
+      return 1;
+    }
+    estimate_options.cache = cache_path ? &cache : nullptr;
+    estimate_options.num_threads = threads;
+
+    auto show_rate = [&] (const char* name, const SolvabilityEstimate& estimate, size_t count) {
+      auto rate = estimate.rate(count, estimate_options.z);
+      cout << name << fixed << setprecision(2) << (rate.rate * 100) << "%  (" << (rate.low * 100) << "% to " << (rate.high * 100) << "%)" << endl;
+    };
+
+    // several deals can be counted at once, so report each time the count passes another hundred
+    size_t reported = 0;
+    auto result = estimate_solvability(estimate_options, [&] (const SolvabilityEstimate& estimate) {
+      if (estimate.deals / 100 > reported / 100) {
+        reported = estimate.deals;
+        cout << estimate.deals << " deals, " << estimate.won << " won, " << estimate.lost << " lost, " << estimate.unknown << " unknown" << endl;
+      }
+    });
+
+    cout << "Sampled " << result.deals << " deals, with 95% confidence intervals:" << endl;
+    show_rate("Won:      ", result, result.won);
+    show_rate("Lost:     ", result, result.lost);
+    show_rate("Unknown:  ", result, result.unknown);
+    return 0;
+  }
+
+  if (generate_path) {
+    ofstream out(generate_path, ios::app);
+    auto start = chrono::steady_clock::now();
+    size_t total_moves = 0;
+    for (int i = 0; i < generate_count; i++) {
+      vector<Move> moves_to_win;
+      GameState game = create_solvable(generate_seed + i, moves_to_win);
+      if (shorten) {
+        shorten_solution(game, moves_to_win);
+      }
+      total_moves += moves_to_win.size();
+      out << deal_to_string(game) << '\t' << moves_to_string(moves_to_win) << '\n';
+    }
+    if (!out) {
+      cout << "Can't write " << generate_path << endl;
+      return 1;
+    }
+    auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Generated " << generate_count << " deals in " << seconds << " seconds, averaging " << (generate_count ? (double) total_moves / generate_count : 0) << " moves" << endl;
+    return 0;
+  }
+
+  if (rating_path) {
+    Tablebase tablebase;
+    if (tablebase_path && !tablebase.open(tablebase_path)) {
+      cout << "Can't open tablebase " << tablebase_path << endl;
+      return 1;
+    }
+    rating_options.tablebase = tablebase_path ? &tablebase : nullptr;
+    SolutionCache cache;
+    if (cache_path && !cache.open(cache_path)) {
+      cout << "Can't open cache " << cache_path << endl;
+      return 1;
+    }
+    rating_options.cache = cache_path ? &cache : nullptr;
+    rating_options.num_threads = threads;
+
+    auto ratings = rate_deals(rating_first_seed, rating_last_seed, rating_options);
+    ofstream out(rating_path);
+    write_rating_index(out, ratings);
+    if (!out) {
+      cout << "Can't write " << rating_path << endl;
+      return 1;
+    }
+    size_t rated = count_if(ratings.begin(), ratings.end(), [] (const DealRating& r) { return r.result == WinResult::WIN; });
+    cout << "Rated " << rated << " of " << ratings.size() << " deals" << endl;
+    return 0;
+  }
+
+  if (hint_state) {
+    GameState game;
+    if (!deal_from_string(hint_state, game)) {
+      cout << "Can't read state " << hint_state << endl;
+      return 1;
+    }
+    cout << game << endl;
+
+    Tablebase tablebase;
+    if (tablebase_path && !tablebase.open(tablebase_path)) {
+      cout << "Can't open tablebase " << tablebase_path << endl;
+      return 1;
+    }
+    HintEngine hints(tablebase_path ? &tablebase : nullptr);
+
+    // keep taking hints until the game is won, to show how quickly they come once a line is known
+    int num_hints = 0;
+    while (1) {
+      auto start = chrono::steady_clock::now();
+      Move move(0, 0);
+      auto result = hints.hint(game, move, chrono::milliseconds(hint_milliseconds));
+      auto milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+      if (result != HintEngine::Result::MOVE) {
+        cout << magic_enum::enum_name(result) << " after " << num_hints << " hints (" << milliseconds << " ms)" << endl;
+        return (result == HintEngine::Result::WON) ? 0 : 1;
+      }
+      cout << "Hint: " << move_to_string(move) << " (" << milliseconds << " ms)" << endl;
+      game.make_move(move);
+      num_hints++;
+    }
+  }
+
+  if (args.size() < 1) {
+    cout << "Usage: solitaire [options] <seed> [max_depth]" << endl;
     cout << "  seed of 0 will choose randomly" << endl;
     cout << "  max_depth defaults to 1000" << endl;
+    cout << "Options:" << endl;
+    cout << "  --external-bfs <dir>  find a shortest solution, storing search layers in dir" << endl;
+    cout << "  --parallel-bfs <n>    find a shortest solution using n threads (0 for all cores)" << endl;
+    cout << "  --order <order>       order to try moves in:  generated (default) or heuristic" << endl;
+    cout << "  --tablebase <file>    look up endgames in the given tablebase" << endl;
+    cout << "  --make-tablebase <file> <cards>  generate a tablebase of states with up to the given cards left" << endl;
+    cout << "  --best-first          find a shortest solution with best-first search" << endl;
+    cout << "  --triage <n> <rate>   play n random playouts first, none longer than max_depth, and skip the search when at least rate of them win" << endl;
+    cout << "  --beam <width>        find a solution quickly with beam search, keeping the best width states of each depth" << endl;
+    cout << "  --pattern-db <file>   estimate moves left for best-first search with the given pattern database" << endl;
+    cout << "  --combine <combine>   combine pattern database suits by max (default, shortest solution) or add (faster)" << endl;
+    cout << "  --make-pattern-db <file>  generate a pattern database" << endl;
+    cout << "  --portfolio <seconds> race several solvers on threads, then keep improving the solution for the given seconds" << endl;
+    cout << "  --anytime <seconds>   keep searching for shorter solutions for the given seconds, showing each one found" << endl;
+    cout << "  --shorten             remove loops and detours from the solution found" << endl;
+    cout << "  --record <file>       append the deal and solution found to the given file" << endl;
+    cout << "  --verify <file>       check every deal and solution recorded in the given file" << endl;
+    cout << "  --threads <n>         threads to use for --verify, --estimate, --rate and --triage (0 for all cores)" << endl;
+    cout << "  --cache <file>        look up and store results of the default solver, --triage and --estimate in the given cache, and store those of --rate" << endl;
+    cout << "  --checkpoint <file>   save the default solver's progress to the given file every few minutes, and when stopped" << endl;
+    cout << "  --resume              carry on from the checkpoint file, if there is one" << endl;
+    cout << "  --hint <state> <ms>   show the next move to win from a seed or packed state, within the given time, until won" << endl;
+    cout << "  --estimate <first> <last>  estimate the fraction of deals won from a sample of the seeds from first to last" << endl;
+    cout << "  --precision <p>       stop --estimate once every rate is known to within p (default 0.01)" << endl;
+    cout << "  --budget <states> <ms>  give up on each deal searched by --estimate or --rate after this many states or milliseconds" << endl;
+    cout << "  --generate <seed> <count> <file>  append count solvable deals and their solutions to file, made by playing backwards" << endl;
+    cout << "  --rate <first> <last> <file>  rate the difficulty of each seed from first to last, writing them easiest first to file" << endl;
     return 1;
   }
 
-  int seed = atoi(argv[1]);
+  int seed = atoi(args[0]);
   if (seed <= 0) {
     srand(time(NULL));
   } else {
@@ -19,8 +323,8 @@ int main(int argc, const char *argv[]) {
   }
 
   int max_depth = 1000;
-  if (argc > 2) {
-    max_depth = atoi(argv[2]);
+  if (args.size() > 1) {
+    max_depth = atoi(args[1]);
   }
 
   GameState game = GameState::create_random();
@@ -28,9 +332,141 @@ int main(int argc, const char *argv[]) {
   // print game
   cout << game << endl;
 
+  // load any tables used by the solvers
+  PatternDatabase pattern_db;
+  if (pattern_db_path && !pattern_db.load(pattern_db_path)) {
+    cout << "Can't open pattern database " << pattern_db_path << endl;
+    return 1;
+  }
+  Tablebase tablebase;
+  if (tablebase_path && !tablebase.open(tablebase_path)) {
+    cout << "Can't open tablebase " << tablebase_path << endl;
+    return 1;
+  }
+  SolutionCache cache;
+  if (cache_path && !cache.open(cache_path)) {
+    cout << "Can't open cache " << cache_path << endl;
+    return 1;
+  }
+
   // solve game
   vector<Move> moves_to_win;
-  bool result = solve_game_dfs(game, moves_to_win, max_depth);
+  bool result;
+  if (portfolio_seconds >= 0) {
+    auto engines = default_portfolio(pattern_db_path ? &pattern_db : nullptr, tablebase_path ? &tablebase : nullptr);
+    int winning_engine = -1;
+    result = solve_game_portfolio(game, moves_to_win, engines, portfolio_seconds, &winning_engine);
+    if (result) {
+      cout << "Solved by " << engines[winning_engine].name() << endl;
+    }
+  } else if (anytime_seconds >= 0) {
+    SolveOptions options;
+    if (tablebase_path) {
+      options.tablebase = &tablebase;
+    }
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(anytime_seconds));
+    result = solve_game_anytime(game, moves_to_win, deadline, [&] (const vector<Move>& moves) {
+      cout << "Found solution with " << moves.size() << " moves after " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " seconds" << endl;
+    }, options);
+  } else if (external_bfs_dir) {
+    bool failed = false;
+    result = solve_game_external_bfs(game, moves_to_win, external_bfs_dir, 1 << 22, &failed);
+    if (failed)
+      return 1;
+  } else if (parallel_bfs_threads >= 0) {
+    result = solve_game_parallel_bfs(game, moves_to_win, parallel_bfs_threads);
+  } else if (beam_width > 0) {
+    BeamOptions options;
+    options.width = beam_width;
+    options.max_width = max<size_t>(options.max_width, beam_width);
+    options.pattern_db = pattern_db_path ? &pattern_db : nullptr;
+    BeamStats beam_stats;
+    options.stats = &beam_stats;
+    cout << "Beam search memory: " << beam_memory(options.max_width, options.max_depth) / (1 << 20) << " MB" << endl;
+    result = solve_game_beam(game, moves_to_win, options);
+    cout << "width: " << beam_stats.width << "  expanded: " << beam_stats.expanded;
+    if (result) {
+      cout << "  depth: " << beam_stats.depth << endl;
+    } else {
+      cout << (beam_stats.emptied ? "  beam emptied" : "  gave up") << endl;
+    }
+  } else if (best_first) {
+    auto combine_by = (combine == "add") ? PatternDatabase::Combine::ADD : PatternDatabase::Combine::MAX;
+    result = solve_game_best_first(game, moves_to_win, pattern_db_path ? &pattern_db : nullptr, combine_by);
+  } else {
+    HeuristicMoveOrdering heuristic_ordering;
+    SolveOptions options;
+    if (order == "heuristic") {
+      options.ordering = &heuristic_ordering;
+    }
+    if (tablebase_path) {
+      options.tablebase = &tablebase;
+    }
+    if (checkpoint_path) {
+      options.checkpoint_path = checkpoint_path;
+      options.resume = resume;
+      options.cancel = &interrupted;
+      signal(SIGINT, handle_interrupt);
+      signal(SIGTERM, handle_interrupt);
+    }
+    // the cache is checked before the playouts, and keeps what they find too
+    bool cache_hit = cache_path && find_cached(game, moves_to_win, max_depth, options, cache, result);
+    bool triaged = false;
+    if (!cache_hit && triage_playouts > 0) {
+      PlayoutResult playouts;
+      PlayoutOptions playout_options;
+      playout_options.playouts = triage_playouts;
+      playout_options.num_threads = threads;
+      playout_options.max_moves = min(playout_options.max_moves, max_depth);   // so the solution fits the depth asked for
+      auto start = chrono::steady_clock::now();
+      triaged = solve_game_playouts(game, moves_to_win, triage_rate, playout_options, &playouts);
+      cout << "Playouts won " << playouts.wins << " of " << playouts.playouts << (triaged ? ", using the best one" : ", searching") << endl;
+
+      if (triaged && cache_path) {
+        SolutionCache::Entry entry;
+        entry.result = SolutionCache::Result::SOLVED;
+        entry.moves_to_win = moves_to_win;
+        entry.states_searched = playouts.states_searched;
+        entry.milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        entry.max_depth = max_depth;
+        cache.store(game, entry);
+      }
+    }
+
+    if (cache_hit) {
+      cout << "Found in cache" << endl;
+    } else if (triaged) {
+      result = true;
+    } else if (cache_path) {
+      result = solve_game_cached(game, moves_to_win, max_depth, options, cache);
+    } else {
+      result = solve_game_dfs(game, moves_to_win, max_depth, options);
+    }
+  }
+
+  if (!result && interrupted) {
+    cout << "Stopped, progress saved to " << checkpoint_path << endl;
+    return 1;
+  }
+
+  if (result && shorten) {
+    int original_size = moves_to_win.size();
+    shorten_solution(game, moves_to_win);
+    cout << "Shortened solution from " << original_size << " to " << moves_to_win.size() << " moves" << endl;
+  }
+
+  if (result) {
+    string error;
+    if (!verify_solution(game, moves_to_win, &error)) {
+      cout << "Invalid solution: " << error << endl;
+      return 1;
+    }
+    if (record_path) {
+      ofstream out(record_path, ios::app);
+      out << deal_to_string(game) << '\t' << moves_to_string(moves_to_win) << endl;
+    }
+  }
 
   if (result) {
     // print moves in reverse
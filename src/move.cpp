@@ -5,6 +5,16 @@ using namespace std;
 Move::Move(int from, int to, int size, bool implicit) : from(from), to(to), size(size), implicit(implicit) {
 }
 
+bool operator==(const Move& m1, const Move& m2)
+{
+  return (m1.from == m2.from) && (m1.to == m2.to) && (m1.size == m2.size) && (m1.implicit == m2.implicit);
+}
+
+bool operator!=(const Move& m1, const Move& m2)
+{
+  return !(m1 == m2);
+}
+
 ostream& operator<<(ostream& os, const Move& move) {
   os << "<move " << move.from << ',' << move.to;
   if (move.size != 1)
@@ -12,4 +12,6 @@ public:
   bool implicit;  // true when it's an automatic move without player choice
 
   friend std::ostream& operator<<(std::ostream& os, const Move& move);
+  friend bool operator==(const Move& m1, const Move& m2);
+  friend bool operator!=(const Move& m1, const Move& m2);
 };
@@ -0,0 +1,163 @@
+#include "move_order.h"
+
+#include <algorithm>
+
+using namespace std;
+
+int cards_done(const GameState& game) {
+  int count = game.blank_done;
+  for (int s = 0; s < num_suits; s++) {
+    count += game.done[s];
+    if (game.slots[s].dragon_done())
+      count += num_dragons;
+  }
+  return count;
+}
+
+// the card being moved, which is the bottom card of the stack when moving between piles
+static Card moved_card(const GameState& game, const Move& move) {
+  if (move.from < 0)
+    return game.slots[-move.from-1];
+  return game.piles[move.from][game.pile_sizes[move.from] - move.size];
+}
+
+HeuristicMoveOrdering::HeuristicMoveOrdering(unsigned seed) : killers(max_killer_depth * 2, Move(0, 0, 0, false)), seed(seed), rng(seed) {
+  for (int c = 0; c < num_card_kinds; c++) {
+    for (int d = 0; d < num_dest_kinds; d++) {
+      history[c][d] = 0;
+    }
+  }
+}
+
+// history is kept per card and kind of destination, rather than per pile, since the same card
+// tends to be a good or bad one to move wherever it happens to be
+int HeuristicMoveOrdering::history_index(const GameState& game, const Move& move, int& dest_kind) {
+  if (move.to == move_to_done) {
+    dest_kind = 0;
+  } else if (move.to < 0) {
+    dest_kind = 3;
+  } else if (game.pile_sizes[move.to] == 0) {
+    dest_kind = 2;
+  } else {
+    dest_kind = 1;
+  }
+
+  auto card = moved_card(game, move);
+  if (card.blank())
+    return num_card_kinds - 1;
+  if (card.dragon())
+    return (num_suits * max_value) + card.suit();
+  return (card.suit() * max_value) + (card.value() - 1);
+}
+
+int HeuristicMoveOrdering::score_move(const GameState& game, const Move& move) const {
+  auto card = moved_card(game, move);
+  int score = 0;
+
+  if (move.to == move_to_done) {
+    // dragons are worth the most, since they also free up slots
+    return card.dragon() ? 1000 : 800;
+  }
+
+  if (move.from < 0) {
+    // frees up a slot
+    score += 200;
+  } else {
+    int size = game.pile_sizes[move.from];
+    int h = size - move.size - 1;
+    if (h < 0) {
+      // empties the pile, although there's no point moving a whole pile to another empty pile
+      if (move.to >= 0 && game.pile_sizes[move.to] == 0)
+        return -1000;
+      score += 300;
+    } else {
+      auto uncovered = game.piles[move.from][h];
+      if (uncovered.normal()) {
+        // the closer the uncovered card is to being needed, the better
+        int needed_in = uncovered.value() - game.done[uncovered.suit()];
+        score += max(0, 400 - 60 * needed_in);
+      } else if (uncovered.dragon()) {
+        score += 150;
+      }
+
+      // digging towards the next needed card of any suit, further down this pile
+      for (int b = h - 1; b >= 0; b--) {
+        auto below = game.piles[move.from][b];
+        if (below.normal() && below.value() == game.done[below.suit()] + 1) {
+          score += max(0, 100 - 10 * (h - b));
+          break;
+        }
+      }
+    }
+  }
+
+  if (move.to < 0) {
+    // fills up a free slot
+    score -= 250;
+  } else if (game.pile_sizes[move.to] == 0) {
+    // uses up an empty pile, which is only worthwhile when it uncovers something
+    score -= 150;
+  } else {
+    // longer stacks are better, since they keep more cards in order
+    score += 10 * move.size;
+  }
+
+  return score;
+}
+
+void HeuristicMoveOrdering::order_moves(const GameState& game, vector<Move>& moves, int depth) {
+  if (moves.size() < 2)
+    return;
+
+  auto killer = &killers[min(depth, max_killer_depth-1) * 2];
+
+  vector<pair<int, Move>> scored;
+  scored.reserve(moves.size());
+  for (auto& move : moves) {
+    int dest_kind;
+    int index = history_index(game, move, dest_kind);
+    int score = score_move(game, move) * 16 + min(history[index][dest_kind], 15 * 16);
+    if (move == killer[0]) {
+      score += 400;
+    } else if (move == killer[1]) {
+      score += 200;
+    }
+    if (seed) {
+      score += rng() % 16;  // less than one point of the move's own score
+    }
+    scored.emplace_back(score, move);
+  }
+
+  // stable, so that moves with equal scores keep the order they were generated in
+  stable_sort(scored.begin(), scored.end(), [] (auto& l, auto& r) {
+    return l.first > r.first;
+  });
+
+  for (size_t i = 0; i < moves.size(); i++) {
+    moves[i] = scored[i].second;
+  }
+}
+
+void HeuristicMoveOrdering::move_searched(const GameState& game, const Move& move, int depth, bool progressed) {
+  if (!progressed)
+    return;
+
+  int dest_kind;
+  int index = history_index(game, move, dest_kind);
+  history[index][dest_kind] += 16;
+
+  // age the whole table once any entry gets large, so that recent progress counts for more
+  if (history[index][dest_kind] > 1 << 16) {
+    for (int c = 0; c < num_card_kinds; c++) {
+      for (int d = 0; d < num_dest_kinds; d++) {
+        history[c][d] /= 2;
+      }
+    }
+  }
+
+  auto killer = &killers[min(depth, max_killer_depth-1) * 2];
+  if (move != killer[0]) {
+    killer[1] = killer[0];
+    killer[0] = move;
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "game.h"
+
+// Decides the order in which the depth-first solver tries the moves from each state.
+// The solver also reports back on how the search below each move went, so that orderings can learn as it runs.
+class MoveOrdering {
+public:
+  virtual ~MoveOrdering() {}
+
+  // sort the moves into the order to try them, best first
+  virtual void order_moves(const GameState& game, std::vector<Move>& moves, int depth) = 0;
+
+  // called once the search below a move has finished without a win.
+  // progressed is true when it reached a state with more cards done than any state before it
+  virtual void move_searched(const GameState& game, const Move& move, int depth, bool progressed) {}
+};
+
+// Tries moves in the order they're generated, which is the solver's original behaviour.
+class GeneratedMoveOrdering : public MoveOrdering {
+public:
+  void order_moves(const GameState& game, std::vector<Move>& moves, int depth) override {}
+};
+
+// Scores each move by how much it helps towards getting cards to done:  uncovering the next card needed for a suit,
+// uncovering dragons, emptying piles and slots, and a penalty for filling up a free slot.
+// Ties are broken by history and killer moves, learned from which moves made progress earlier in the search.
+// A nonzero seed also breaks ties randomly, so that differently seeded searches explore different lines.
+class HeuristicMoveOrdering : public MoveOrdering {
+public:
+  HeuristicMoveOrdering(unsigned seed = 0);
+
+  void order_moves(const GameState& game, std::vector<Move>& moves, int depth) override;
+  void move_searched(const GameState& game, const Move& move, int depth, bool progressed) override;
+
+  int score_move(const GameState& game, const Move& move) const;
+
+private:
+  static const int num_card_kinds = (num_suits * max_value) + num_suits + 1;  // normal cards, dragons, blank
+  static const int num_dest_kinds = 4;                                        // done, card, empty pile, slot
+  static const int max_killer_depth = 1024;
+
+  int history[num_card_kinds][num_dest_kinds];
+  std::vector<Move> killers;  // two per depth
+  unsigned seed;
+  std::mt19937 rng;
+
+  static int history_index(const GameState& game, const Move& move, int& dest_kind);
+};
+
+// Cards moved to done so far, counting each stack of dragons and the blank card too
+int cards_done(const GameState& game);
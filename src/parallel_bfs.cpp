@@ -0,0 +1,181 @@
+#include "parallel_bfs.h"
+#include "deadlock.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+using namespace std;
+
+// a state in one of the stored layers, along with where to find the state it was reached from
+struct LayerNode {
+  PackedState state;
+  int parent_shard;
+  int parent_index;
+};
+
+// run the given function on each thread, and wait for all of them to finish
+template <typename F>
+static void run_threads(int num_threads, F f) {
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back(f, t);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+bool solve_game_parallel_bfs(const GameState& game, vector<Move>& moves_to_win, int num_threads) {
+  if (game.win())
+    return true;
+
+  if (num_threads <= 0)
+    num_threads = max(1u, thread::hardware_concurrency());
+
+  const int num_shards = num_threads * 4;
+  PackedStateHash hasher;
+
+  // layers[depth][shard] holds the states first reached at that depth
+  vector<vector<vector<LayerNode>>> layers;
+  vector<unordered_set<PackedState, PackedStateHash>> visited_states(num_shards);
+
+  // children produced by each thread, bucketed by the shard that owns them
+  vector<vector<vector<LayerNode>>> buffers(num_threads, vector<vector<LayerNode>>(num_shards));
+
+  GameState start = game;
+  start.normalize();
+  PackedState start_packed = start.pack();
+  int start_shard = hasher(start_packed) % num_shards;
+  layers.emplace_back(num_shards);
+  layers[0][start_shard].push_back({start_packed, -1, -1});
+  visited_states[start_shard].insert(start_packed);
+
+  mutex win_mutex;
+  atomic<bool> found(false);
+  int win_shard = -1;
+  int win_index = -1;
+
+  while (!found) {
+    auto& layer = layers.back();
+    int depth = layers.size() - 1;
+
+    // flatten the layer into a list of work items, so that threads can claim them in chunks
+    vector<pair<int,int>> work;
+    for (int s = 0; s < num_shards; s++) {
+      for (int i = 0; i < (int) layer[s].size(); i++) {
+        work.emplace_back(s, i);
+      }
+    }
+
+    if (work.empty())
+      break;  // no solution found
+
+    cout << "depth: " << depth << "  states: " << work.size() << endl;
+
+    // expand every state in the layer
+    atomic<size_t> next_work(0);
+    const size_t chunk = 256;
+
+    run_threads(num_threads, [&] (int t) {
+      vector<Move> moves;
+      auto& shard_buffers = buffers[t];
+
+      while (!found) {
+        size_t begin = next_work.fetch_add(chunk);
+        if (begin >= work.size())
+          break;
+        size_t end = min(begin + chunk, work.size());
+
+        for (size_t w = begin; w < end; w++) {
+          auto [s, i] = work[w];
+          GameState state = GameState::unpack(layer[s][i].state);
+          generate_moves(state, moves);
+
+          for (auto& move : moves) {
+            GameState next_state = state;
+            next_state.make_move(move);
+
+            // Base case - we found a winning state!
+            if (next_state.win()) {
+              lock_guard<mutex> lock(win_mutex);
+              if (!found) {
+                win_shard = s;
+                win_index = i;
+                found = true;
+              }
+              break;
+            }
+
+            // Don't bother visiting states that can be proven unwinnable
+            if (is_dead_state(next_state))
+              continue;
+
+            next_state.normalize();
+            PackedState packed = next_state.pack();
+            shard_buffers[hasher(packed) % num_shards].push_back({packed, s, i});
+          }
+        }
+      }
+    });
+
+    if (found)
+      break;
+
+    // each thread deduplicates the shards it owns, against that shard's visited states only
+    layers.emplace_back(num_shards);
+    auto& next_layer = layers.back();
+
+    run_threads(num_threads, [&] (int t) {
+      for (int s = t; s < num_shards; s += num_threads) {
+        for (int b = 0; b < num_threads; b++) {
+          for (auto& node : buffers[b][s]) {
+            if (visited_states[s].insert(node.state).second) {
+              next_layer[s].push_back(node);
+            }
+          }
+          buffers[b][s].clear();
+        }
+      }
+    });
+  }
+
+  if (!found)
+    return false;
+
+  // follow the parent links back to the start, then replay the line of normalized states from the actual game
+  vector<PackedState> line;
+  for (int d = layers.size() - 1, s = win_shard, i = win_index; d > 0; d--) {
+    auto& node = layers[d][s][i];
+    line.push_back(node.state);
+    s = node.parent_shard;
+    i = node.parent_index;
+  }
+
+  vector<Move> forward_moves;
+  GameState state = game;
+  for (auto i = line.rbegin(); i != line.rend(); i++) {
+    Move move(0, 0);
+    if (!find_move_to(state, GameState::unpack(*i), move))
+      return false;
+    forward_moves.push_back(move);
+    state.make_move(move);
+  }
+
+  // finally, the move that wins the game
+  vector<Move> moves;
+  generate_moves(state, moves, true);
+  for (auto& move : moves) {
+    GameState next_state = state;
+    next_state.make_move(move);
+    if (next_state.win()) {
+      forward_moves.push_back(move);
+      // solutions are returned in reverse order
+      moves_to_win.insert(moves_to_win.end(), forward_moves.rbegin(), forward_moves.rend());
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+
+// Level-synchronous breadth-first search, expanding each depth layer across threads.
+// Children are partitioned into shards by hash, and each shard is deduplicated by a single thread,
+// so no locks are needed on the visited states.  A thread count of 0 uses all available cores.
+bool solve_game_parallel_bfs(const GameState& game, std::vector<Move>& moves_to_win, int num_threads = 0);
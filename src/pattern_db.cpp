@@ -0,0 +1,292 @@
+#include "pattern_db.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// an arrangement of one suit is stored in 4 bits per card:  the card of the same suit somewhere beneath it in its pile,
+// or one of the markers below.  pile and slot order doesn't show up in it, so each arrangement has a single key
+typedef uint64_t PatternKey;
+
+static const int below_done = 0xf;    // the card is done
+static const int below_bottom = 0;    // no card of the suit beneath it
+static const PatternKey empty_key = ~0ULL;
+static const int key_bits = 4 * max_value;
+static const PatternKey key_mask = (1ULL << key_bits) - 1;
+
+// the file is the magic and the rules signature, followed by the sorted records.  each record is 5 bytes:  the key, and the extra moves above it
+static const char pattern_db_magic[8] = {'S', 'H', 'Z', 'X', 'P', 'D', '0', '2'};
+static const int record_size = 5;
+static const int max_extra_moves = 0xf;
+
+static int below(PatternKey key, int value) {
+  return (key >> (4 * (value-1))) & 0xf;
+}
+
+static PatternKey set_below(PatternKey key, int value, int b) {
+  int shift = 4 * (value-1);
+  return (key & ~(0xfULL << shift)) | ((PatternKey) b << shift);
+}
+
+static int done_value(PatternKey key) {
+  int d = 0;
+  while (d < max_value && below(key, d+1) == below_done) {
+    d++;
+  }
+  return d;
+}
+
+static PatternKey project_suit(const GameState& game, int suit) {
+  PatternKey key = 0;
+  for (int v = 1; v <= game.done[suit]; v++) {
+    key = set_below(key, v, below_done);
+  }
+
+  // cards in slots have nothing beneath them, which is already the case
+  for (int p = 0; p < num_piles; p++) {
+    int last = below_bottom;
+    for (int h = 0; h < game.pile_sizes[p]; h++) {
+      auto card = game.piles[p][h];
+      if (card.normal() && card.present() && card.suit() == suit) {
+        key = set_below(key, card.value(), last);
+        last = card.value();
+      }
+    }
+  }
+
+  return key;
+}
+
+// calls f on every arrangement one projected move away.  moving stacks between piles can always be undone,
+// so these are also the arrangements one move before, apart from moves to done, which are included when
+// backwards is set instead
+template <typename F>
+static void for_each_neighbour(PatternKey key, bool backwards, F f) {
+  bool has_above[max_value+1] = {};
+  for (int v = 1; v <= max_value; v++) {
+    int b = below(key, v);
+    if (b != below_done && b != below_bottom)
+      has_above[b] = true;
+  }
+
+  int tops[max_value];
+  int num_tops = 0;
+  for (int v = 1; v <= max_value; v++) {
+    if (below(key, v) != below_done && !has_above[v])
+      tops[num_tops++] = v;
+  }
+
+  // stacks from the top of each pile, onto another pile or an empty one.  within a real stack, cards of different suits
+  // are between any two cards of the same suit, so those always step down by at least two
+  for (int i = 0; i < num_tops; i++) {
+    int bottom = tops[i];
+    while (1) {
+      int beneath = below(key, bottom);
+      if (beneath != below_bottom)
+        f(set_below(key, bottom, below_bottom));
+      for (int j = 0; j < num_tops; j++) {
+        if (j != i)
+          f(set_below(key, bottom, tops[j]));
+      }
+
+      if (beneath == below_bottom || beneath < bottom + 2)
+        break;
+      bottom = beneath;
+    }
+  }
+
+  int d = done_value(key);
+  if (backwards) {
+    // the last card done, back onto any pile
+    if (d > 0) {
+      f(set_below(key, d, below_bottom));
+      for (int j = 0; j < num_tops; j++) {
+        f(set_below(key, d, tops[j]));
+      }
+    }
+  } else {
+    if (d < max_value && !has_above[d+1])
+      f(set_below(key, d+1, below_done));
+  }
+}
+
+// open addressing hash table from keys to distances, used while generating
+class PatternTable {
+public:
+  PatternTable(int bits) : keys(1ULL << bits, empty_key), distances(1ULL << bits), mask((1ULL << bits) - 1), count(0) {}
+
+  // returns false if the key was already present
+  bool insert(PatternKey key, uint8_t distance) {
+    size_t i = slot(key);
+    if (keys[i] == key)
+      return false;
+    keys[i] = key;
+    distances[i] = distance;
+    count++;
+    return true;
+  }
+
+  size_t size() const { return count; }
+  size_t capacity() const { return keys.size(); }
+
+  template <typename F>
+  void for_each(F f) const {
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (keys[i] != empty_key)
+        f(keys[i], distances[i]);
+    }
+  }
+
+private:
+  vector<PatternKey> keys;
+  vector<uint8_t> distances;
+  size_t mask;
+  size_t count;
+
+  size_t slot(PatternKey key) const {
+    size_t i = (key * 0x9e3779b97f4a7c15ULL) >> 20 & mask;
+    while (keys[i] != empty_key && keys[i] != key) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+};
+
+bool generate_pattern_database(const string& path) {
+  // enough room for every arrangement of up to max_value cards in any number of piles
+  PatternTable table(24);
+
+  PatternKey goal = 0;
+  for (int v = 1; v <= max_value; v++) {
+    goal = set_below(goal, v, below_done);
+  }
+
+  // breadth-first search backwards from the finished suit, which reaches every arrangement
+  vector<PatternKey> layer = {goal};
+  table.insert(goal, 0);
+
+  for (int distance = 1; !layer.empty(); distance++) {
+    vector<PatternKey> next_layer;
+    for (auto key : layer) {
+      for_each_neighbour(key, true, [&] (PatternKey prev_key) {
+        if (table.insert(prev_key, distance))
+          next_layer.push_back(prev_key);
+      });
+    }
+
+    cout << "distance: " << distance << "  arrangements: " << next_layer.size() << endl;
+    layer.swap(next_layer);
+
+    if (table.size() * 2 > table.capacity()) {
+      cout << "pattern table is full" << endl;
+      return false;
+    }
+  }
+
+  // store the distance beyond one move to done per card left, which is small enough for the rest of the record
+  vector<uint64_t> sorted_records;
+  bool fits = true;
+  table.for_each([&] (PatternKey key, uint8_t distance) {
+    int extra = distance - (max_value - done_value(key));
+    if (extra < 0 || extra > max_extra_moves)
+      fits = false;
+    sorted_records.push_back(key | ((uint64_t) extra << key_bits));
+  });
+  if (!fits)
+    return false;
+
+  sort(sorted_records.begin(), sorted_records.end(), [] (uint64_t l, uint64_t r) {
+    return (l & key_mask) < (r & key_mask);
+  });
+
+  ofstream out(path, ios::binary);
+  auto rules = RulesSignature::current();
+  out.write(pattern_db_magic, sizeof(pattern_db_magic));
+  out.write((const char*) &rules, sizeof(rules));
+  for (auto record : sorted_records) {
+    for (int b = 0; b < record_size; b++) {
+      out.put((char) (record >> (8 * b)));
+    }
+  }
+
+  cout << "pattern database arrangements: " << sorted_records.size() << endl;
+  return (bool) out;
+}
+
+bool PatternDatabase::load(const string& path) {
+  records.clear();
+
+  ifstream in(path, ios::binary | ios::ate);
+  if (!in)
+    return false;
+
+  size_t size = in.tellg();
+  char magic[sizeof(pattern_db_magic)];
+  RulesSignature rules;
+  in.seekg(0);
+  if (size < sizeof(magic) + sizeof(rules) || !in.read(magic, sizeof(magic)) || memcmp(magic, pattern_db_magic, sizeof(magic)) != 0)
+    return false;
+  if (!in.read((char*) &rules, sizeof(rules)) || !rules.matches_current())
+    return false;
+
+  size -= sizeof(magic) + sizeof(rules);
+  if (size % record_size != 0)
+    return false;
+
+  records.resize(size);
+  if (!in.read((char*) records.data(), size)) {
+    records.clear();
+    return false;
+  }
+  return true;
+}
+
+int PatternDatabase::extra_moves(const GameState& game, int suit) const {
+  PatternKey key = project_suit(game, suit);
+
+  auto record_at = [&] (size_t i) {
+    uint64_t record = 0;
+    for (int b = 0; b < record_size; b++) {
+      record |= (uint64_t) records[i * record_size + b] << (8 * b);
+    }
+    return record;
+  };
+
+  size_t lo = 0;
+  size_t hi = records.size() / record_size;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    uint64_t record = record_at(mid);
+    PatternKey mid_key = record & key_mask;
+    if (mid_key == key)
+      return record >> key_bits;
+    if (mid_key < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return 0;  // every arrangement is in the table, so this only happens when it isn't loaded
+}
+
+int moves_to_done(const GameState& game) {
+  int count = (num_blanks - game.blank_done) + num_suits;
+  for (int s = 0; s < num_suits; s++) {
+    count += max_value - game.done[s];
+    if (game.slots[s].dragon_done())
+      count--;  // one group of dragons already done
+  }
+  return count;
+}
+
+int PatternDatabase::estimate(const GameState& game, Combine combine) const {
+  int extra = 0;
+  for (int s = 0; s < num_suits; s++) {
+    int suit_extra = extra_moves(game, s);
+    extra = (combine == Combine::MAX) ? max(extra, suit_extra) : (extra + suit_extra);
+  }
+  return moves_to_done(game) + extra;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Pattern database of lower bounds on the moves needed to finish a single suit.
+//
+// The game is projected onto the cards of one suit:  which of them are done, and for each one left,
+// which card of the same suit is somewhere beneath it in the same pile.  Every other card is ignored,
+// so a card can be moved onto any pile, and stacks can be moved as long as the suit's cards in them could
+// be part of a real stack.  The projected game is solved exhaustively, backwards from the finished suit.
+// All suits share the same table, since the projection doesn't depend on which suit it is.
+//
+// The table stores the extra moves beyond one move to done per card, which is what the blocking cards cost.
+class PatternDatabase {
+public:
+  enum class Combine {
+    MAX,  // largest extra cost of any suit:  a true lower bound
+    ADD,  // sum of the extra costs:  stronger, but not a lower bound, since one stack move can help several suits
+  };
+
+  bool load(const std::string& path);
+  bool is_loaded() const { return !records.empty(); }
+
+  // extra moves needed to finish the given suit, beyond moving each of its cards to done
+  int extra_moves(const GameState& game, int suit) const;
+
+  // estimate of the moves left to win:  every move to done still needed, plus the combined extra costs
+  int estimate(const GameState& game, Combine combine) const;
+
+private:
+  std::vector<uint8_t> records;
+};
+
+// Moves to done still needed to win:  each card, each group of dragons, and the blank card
+int moves_to_done(const GameState& game);
+
+// Solves the projected game for every arrangement of a suit, and writes the table to the given file
+bool generate_pattern_database(const std::string& path);
@@ -0,0 +1,191 @@
+#include "pile_moves.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PILE_MOVES_X86
+#endif
+
+using namespace std;
+
+static void pile_move_masks_scalar(const uint8_t bottoms[num_piles], const uint8_t tops[num_piles], PileMask masks[num_piles]) {
+  for (int from = 0; from < num_piles; from++) {
+    PileMask mask = 0;
+    for (int to = 0; to < num_piles; to++) {
+      mask |= (PileMask) card_tables.stacks(bottoms[from], tops[to]) << to;
+    }
+    masks[from] = mask;
+  }
+}
+
+#ifdef PILE_MOVES_X86
+
+// the same rule as the card tables, on the bytes of card codes:  a present card goes onto an empty pile, or a normal card
+// goes onto a normal card of a different suit, one value higher.  normal cards have a suit of at least 0 and a value of
+// at least 0, so at least 1 in the high nibble and at least num_dragons in the low nibble
+static __m128i stacks_onto_sse2(__m128i cards, __m128i tops) {
+  const __m128i no = _mm_set1_epi8(no_card.code);
+  const __m128i low_mask = _mm_set1_epi8(0x0f);
+
+  __m128i card_low = _mm_and_si128(cards, low_mask);
+  __m128i top_low = _mm_and_si128(tops, low_mask);
+  __m128i card_high = _mm_and_si128(_mm_srli_epi16(cards, card_value_bits), low_mask);
+  __m128i top_high = _mm_and_si128(_mm_srli_epi16(tops, card_value_bits), low_mask);
+
+  __m128i min_low = _mm_set1_epi8(num_dragons - 1);
+  __m128i card_normal = _mm_and_si128(_mm_cmpgt_epi8(card_low, min_low), _mm_cmpgt_epi8(card_high, _mm_setzero_si128()));
+  __m128i top_normal = _mm_and_si128(_mm_cmpgt_epi8(top_low, min_low), _mm_cmpgt_epi8(top_high, _mm_setzero_si128()));
+
+  __m128i one_lower = _mm_cmpeq_epi8(_mm_add_epi8(card_low, _mm_set1_epi8(1)), top_low);
+  __m128i same_suit = _mm_cmpeq_epi8(card_high, top_high);
+  __m128i onto_card = _mm_andnot_si128(same_suit, _mm_and_si128(_mm_and_si128(card_normal, top_normal), one_lower));
+
+  __m128i card_missing = _mm_cmpeq_epi8(cards, no);
+  __m128i onto_empty = _mm_cmpeq_epi8(tops, no);
+  return _mm_andnot_si128(card_missing, _mm_or_si128(onto_empty, onto_card));
+}
+
+// each bottom card repeated across a row of 8 bytes, two rows to a register
+static void spread_bottoms(const uint8_t bottoms[num_piles], __m128i rows[4]) {
+  __m128i b = _mm_loadl_epi64((const __m128i*) bottoms);
+  __m128i pairs = _mm_unpacklo_epi8(b, b);
+  __m128i quads_low = _mm_unpacklo_epi16(pairs, pairs);
+  __m128i quads_high = _mm_unpackhi_epi16(pairs, pairs);
+  rows[0] = _mm_unpacklo_epi32(quads_low, quads_low);
+  rows[1] = _mm_unpackhi_epi32(quads_low, quads_low);
+  rows[2] = _mm_unpacklo_epi32(quads_high, quads_high);
+  rows[3] = _mm_unpackhi_epi32(quads_high, quads_high);
+}
+
+// the 8x8 bitmask from the vector versions has a byte of destinations for each pile
+static void split_rows(uint64_t mask, PileMask masks[num_piles]) {
+  for (int from = 0; from < 8 && from < num_piles; from++) {
+    masks[from] = (mask >> (from * 8)) & 0xff;
+  }
+}
+
+static void pile_move_masks_sse2(const uint8_t bottoms[num_piles], const uint8_t tops[num_piles], PileMask masks[num_piles]) {
+  __m128i rows[4];
+  spread_bottoms(bottoms, rows);
+  __m128i t = _mm_loadl_epi64((const __m128i*) tops);
+  t = _mm_unpacklo_epi64(t, t);
+
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(stacks_onto_sse2(rows[i], t)) << (i * 16);
+  }
+  split_rows(mask, masks);
+}
+
+__attribute__((target("avx2")))
+static __m256i stacks_onto_avx2(__m256i cards, __m256i tops) {
+  const __m256i no = _mm256_set1_epi8(no_card.code);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+  __m256i card_low = _mm256_and_si256(cards, low_mask);
+  __m256i top_low = _mm256_and_si256(tops, low_mask);
+  __m256i card_high = _mm256_and_si256(_mm256_srli_epi16(cards, card_value_bits), low_mask);
+  __m256i top_high = _mm256_and_si256(_mm256_srli_epi16(tops, card_value_bits), low_mask);
+
+  __m256i min_low = _mm256_set1_epi8(num_dragons - 1);
+  __m256i card_normal = _mm256_and_si256(_mm256_cmpgt_epi8(card_low, min_low), _mm256_cmpgt_epi8(card_high, _mm256_setzero_si256()));
+  __m256i top_normal = _mm256_and_si256(_mm256_cmpgt_epi8(top_low, min_low), _mm256_cmpgt_epi8(top_high, _mm256_setzero_si256()));
+
+  __m256i one_lower = _mm256_cmpeq_epi8(_mm256_add_epi8(card_low, _mm256_set1_epi8(1)), top_low);
+  __m256i same_suit = _mm256_cmpeq_epi8(card_high, top_high);
+  __m256i onto_card = _mm256_andnot_si256(same_suit, _mm256_and_si256(_mm256_and_si256(card_normal, top_normal), one_lower));
+
+  __m256i card_missing = _mm256_cmpeq_epi8(cards, no);
+  __m256i onto_empty = _mm256_cmpeq_epi8(tops, no);
+  return _mm256_andnot_si256(card_missing, _mm256_or_si256(onto_empty, onto_card));
+}
+
+__attribute__((target("avx2")))
+static void pile_move_masks_avx2(const uint8_t bottoms[num_piles], const uint8_t tops[num_piles], PileMask masks[num_piles]) {
+  __m128i rows[4];
+  spread_bottoms(bottoms, rows);
+  __m128i t = _mm_loadl_epi64((const __m128i*) tops);
+  __m256i t4 = _mm256_broadcastq_epi64(t);
+
+  __m256i low = _mm256_inserti128_si256(_mm256_castsi128_si256(rows[0]), rows[1], 1);
+  __m256i high = _mm256_inserti128_si256(_mm256_castsi128_si256(rows[2]), rows[3], 1);
+  uint32_t low_mask = _mm256_movemask_epi8(stacks_onto_avx2(low, t4));
+  uint32_t high_mask = _mm256_movemask_epi8(stacks_onto_avx2(high, t4));
+  split_rows(low_mask | ((uint64_t) high_mask << 32), masks);
+}
+
+#endif
+
+typedef void (*PileMoveMaskFunction)(const uint8_t bottoms[num_piles], const uint8_t tops[num_piles], PileMask masks[num_piles]);
+
+static PileMoveKernel current_kernel = PileMoveKernel::SCALAR;
+static PileMoveMaskFunction current_function = pile_move_masks_scalar;
+
+bool set_pile_move_kernel(PileMoveKernel kernel) {
+  PileMoveMaskFunction function = pile_move_masks_scalar;
+
+  if (kernel != PileMoveKernel::SCALAR) {
+#ifdef PILE_MOVES_X86
+    // the vector versions lay out exactly 8 piles, one per byte of a row
+    if (num_piles != 8)
+      return false;
+    if (kernel == PileMoveKernel::AVX2) {
+      if (!__builtin_cpu_supports("avx2"))
+        return false;
+      function = pile_move_masks_avx2;
+    } else {
+      if (!__builtin_cpu_supports("sse2"))
+        return false;
+      function = pile_move_masks_sse2;
+    }
+#else
+    return false;
+#endif
+  }
+
+  current_kernel = kernel;
+  current_function = function;
+  return true;
+}
+
+PileMoveKernel pile_move_kernel() {
+  return current_kernel;
+}
+
+// pick the best kernel the processor can run, before main starts
+[[maybe_unused]] static bool kernel_chosen = set_pile_move_kernel(PileMoveKernel::AVX2) || set_pile_move_kernel(PileMoveKernel::SSE2);
+
+void pile_move_masks(const uint8_t bottoms[num_piles], const uint8_t tops[num_piles], PileMask masks[num_piles]) {
+  current_function(bottoms, tops, masks);
+}
+
+void find_pile_moves(const GameState& game, PileMoves& pile_moves) {
+  uint8_t tops[num_piles];
+  pile_moves.max_run_length = 1;
+
+  // the longest stack off each pile is the run at its top
+  for (int p = 0; p < num_piles; p++) {
+    tops[p] = game.top_card_of_pile(p).code;
+    pile_moves.run_lengths[p] = game.run_lengths[p];
+    pile_moves.max_run_length = max<int>(pile_moves.max_run_length, game.run_lengths[p]);
+  }
+
+  for (int size = 1; size <= pile_moves.max_run_length; size++) {
+    uint8_t bottoms[num_piles];
+    for (int p = 0; p < num_piles; p++) {
+      bottoms[p] = (size <= pile_moves.run_lengths[p]) ? game.piles[p][game.pile_sizes[p] - size].code : no_card.code;
+    }
+    current_function(bottoms, tops, pile_moves.masks[size-1]);
+
+    // the stack can only go onto piles with room for all of it
+    PileMask room = 0;
+    for (int p = 0; p < num_piles; p++) {
+      if (game.pile_sizes[p] + size <= max_pile_size)
+        room |= 1 << p;
+    }
+    for (int p = 0; p < num_piles; p++) {
+      pile_moves.masks[size-1][p] &= room;
+    }
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "game.h"
+
+// Legality of every pile to pile move at once.
+//
+// The stack of each size that could be moved off the top of each pile has a bottom card, and it can be placed
+// onto a pile when that card stacks onto the pile's top card and the pile has room for the whole stack.  For one
+// stack size, the bottom cards are compared against the top cards as bytes of their card codes, giving a mask of the
+// piles each stack can be placed onto, which is then limited to the piles with room.
+// With 8 piles the comparison is vectorized with AVX2 or SSE2 when the processor has them, chosen when the
+// program starts, with a scalar version using the card tables as the fallback and for other numbers of piles.
+enum class PileMoveKernel { SCALAR, SSE2, AVX2 };
+
+struct PileMoves {
+  int run_lengths[num_piles];         // size of the largest stack that can be moved off each pile
+  int max_run_length;
+  PileMask masks[max_pile_size][num_piles];  // destinations of the stack of each size off each pile, from 1 up to max_run_length
+};
+
+void find_pile_moves(const GameState& game, PileMoves& pile_moves);
+
+// the piles each bottom card can be placed onto, given the top cards, as card codes
+void pile_move_masks(const uint8_t bottoms[num_piles], const uint8_t tops[num_piles], PileMask masks[num_piles]);
+
+PileMoveKernel pile_move_kernel();
+bool set_pile_move_kernel(PileMoveKernel kernel);   // returns false if the processor can't run it
@@ -0,0 +1,148 @@
+#include "playout.h"
+#include "deadlock.h"
+#include "move_order.h"
+#include "shortener.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_set>
+
+using namespace std;
+
+// plays one playout, leaving its moves in line in the order they're played
+static bool playout(const GameState& game, const PlayoutOptions& options, mt19937& rng, vector<Move>& line, unordered_set<size_t>& seen) {
+  HeuristicMoveOrdering ordering;
+  GameState state = game;
+  line.clear();
+  seen.clear();
+  state.apply_safe_moves(line);
+
+  GameState normalized = state;
+  normalized.normalize();
+  seen.insert(hash<GameState>()(normalized));
+
+  vector<Move> moves;
+  vector<Move> safe_moves;
+  vector<double> weights;
+  while (!state.win() && (int) line.size() < options.max_moves) {
+    generate_moves(state, moves);
+    // weights are relative to the best move, so they can't overflow
+    weights.resize(moves.size());
+    double best_score = -HUGE_VAL;
+    for (size_t i = 0; i < moves.size(); i++) {
+      weights[i] = ordering.score_move(state, moves[i]);
+      best_score = max(best_score, weights[i]);
+    }
+    for (auto& weight : weights) {
+      weight = exp((weight - best_score) / options.temperature);
+    }
+
+    // draw moves until one leads somewhere new and not dead
+    bool moved = false;
+    while (!moved) {
+      double total = 0;
+      for (auto weight : weights) {
+        total += weight;
+      }
+      if (total <= 0)
+        break;
+      double r = uniform_real_distribution<double>(0, total)(rng);
+      size_t i = 0;
+      while (i + 1 < weights.size() && (r -= weights[i]) >= 0) {
+        i++;
+      }
+      while (weights[i] == 0) {
+        i--;    // rounding past the end, onto a move already drawn
+      }
+      weights[i] = 0;
+
+      auto& move = moves[i];
+      GameState next_state = state;
+      next_state.make_move(move);
+      safe_moves.clear();
+      next_state.apply_safe_moves(safe_moves);
+
+      if (!next_state.win()) {
+        if (is_dead_state(next_state))
+          continue;
+        normalized = next_state;
+        normalized.normalize();
+        if (!seen.insert(hash<GameState>()(normalized)).second)
+          continue;
+      }
+
+      line.push_back(move);
+      line.insert(line.end(), safe_moves.begin(), safe_moves.end());
+      state = next_state;
+      moved = true;
+    }
+    if (!moved)
+      return false;
+  }
+  return state.win();
+}
+
+PlayoutResult run_playouts(const GameState& game, const PlayoutOptions& options) {
+  PlayoutResult result;
+  result.playouts = max(0, options.playouts);
+
+  int num_threads = options.num_threads;
+  if (num_threads <= 0)
+    num_threads = max(1u, thread::hardware_concurrency());
+
+  mutex result_mutex;
+  atomic<int> next_playout(0);
+  vector<Move> best_line;
+  int best_playout = -1;
+
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&] {
+      vector<Move> line;
+      unordered_set<size_t> seen;
+      size_t states_searched = 0;
+      for (int i = next_playout++; i < result.playouts; i = next_playout++) {
+        mt19937 rng(options.seed + i);
+        bool won = playout(game, options, rng, line, seen);
+        states_searched += seen.size();
+        if (!won)
+          continue;
+
+        lock_guard<mutex> lock(result_mutex);
+        result.wins++;
+        // ties go to the earliest playout, whichever thread finished first
+        if (best_playout < 0 || line.size() < best_line.size() || (line.size() == best_line.size() && i < best_playout)) {
+          best_line = line;
+          best_playout = i;
+        }
+      }
+
+      lock_guard<mutex> lock(result_mutex);
+      result.states_searched += states_searched;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // solutions are returned in reverse order
+  result.moves_to_win.assign(best_line.rbegin(), best_line.rend());
+  return result;
+}
+
+bool solve_game_playouts(const GameState& game, vector<Move>& moves_to_win, double min_success_rate,
+    const PlayoutOptions& options, PlayoutResult* result) {
+  auto playouts = run_playouts(game, options);
+  bool solved = playouts.wins > 0 && playouts.success_rate() >= min_success_rate;
+  if (solved) {
+    moves_to_win = playouts.moves_to_win;
+    shorten_solution(game, moves_to_win);
+  }
+  if (result)
+    *result = move(playouts);
+  return solved;
+}
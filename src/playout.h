@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+
+// Random playouts, as a cheap check of how easy a deal is before searching it.
+//
+// Each playout plays random legal moves from the state, with every safe move to done made after each one, until it
+// wins, runs out of moves, or only has moves back to states it has already been through or that are dead.  Moves that
+// score well for the heuristic move ordering are more likely to be drawn, and less so at higher temperatures.  Playouts
+// are spread across threads, and each one has its own random seed, so the results don't depend on the thread count.
+// The shortest winning playout is kept as a solution.
+struct PlayoutOptions {
+  int playouts = 1000;
+  int max_moves = 300;                // moves in each playout before giving up on it
+  double temperature = 200;           // moves are drawn with weight exp(score / temperature), by HeuristicMoveOrdering's score
+  unsigned seed = 1;
+  int num_threads = 0;                // 0 for all cores
+};
+
+struct PlayoutResult {
+  int playouts = 0;
+  int wins = 0;
+  size_t states_searched = 0;         // states the playouts went through, together
+  std::vector<Move> moves_to_win;     // the shortest winning playout, if any won
+
+  double success_rate() const { return playouts ? (double) wins / playouts : 0; }
+};
+
+PlayoutResult run_playouts(const GameState& game, const PlayoutOptions& options = PlayoutOptions());
+
+// Triage before a full search:  solves the deal from the playouts when at least min_success_rate of them win,
+// with the best one shortened.  Otherwise returns false, leaving the deal for the heavier solvers.
+bool solve_game_playouts(const GameState& game, std::vector<Move>& moves_to_win, double min_success_rate,
+    const PlayoutOptions& options = PlayoutOptions(), PlayoutResult* result = nullptr);
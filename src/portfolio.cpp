@@ -0,0 +1,119 @@
+#include "portfolio.h"
+#include "best_first.h"
+#include "move_order.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+string PortfolioEngine::name() const {
+  ostringstream os;
+  if (kind == Kind::DFS) {
+    os << "dfs " << (heuristic_order ? "heuristic" : "generated");
+    if (order_seed)
+      os << " seed " << order_seed;
+    if (tablebase)
+      os << " tablebase";
+  } else {
+    os << "best-first";
+    if (pattern_db)
+      os << " pattern-db " << ((combine == PatternDatabase::Combine::MAX) ? "max" : "add");
+  }
+  return os.str();
+}
+
+vector<PortfolioEngine> default_portfolio(const PatternDatabase* pattern_db, const Tablebase* tablebase) {
+  vector<PortfolioEngine> engines;
+
+  for (unsigned seed = 0; seed < 3; seed++) {
+    PortfolioEngine dfs;
+    dfs.order_seed = seed;
+    dfs.tablebase = tablebase;
+    engines.push_back(dfs);
+  }
+
+  PortfolioEngine generated;
+  generated.heuristic_order = false;
+  generated.tablebase = tablebase;
+  engines.push_back(generated);
+
+  PortfolioEngine best_first;
+  best_first.kind = PortfolioEngine::Kind::BEST_FIRST;
+  best_first.pattern_db = pattern_db;
+  engines.push_back(best_first);
+
+  return engines;
+}
+
+// whether the engine's solutions are always shortest, so that nothing else can improve on them
+static bool finds_shortest(const PortfolioEngine& engine) {
+  return engine.kind == PortfolioEngine::Kind::BEST_FIRST && engine.combine == PatternDatabase::Combine::MAX;
+}
+
+bool solve_game_portfolio(const GameState& game, vector<Move>& moves_to_win, const vector<PortfolioEngine>& engines,
+    double improve_seconds, int* winning_engine) {
+  atomic<bool> cancel(false);
+  mutex result_mutex;
+  condition_variable result_changed;
+
+  vector<Move> best_moves;
+  int best_engine = -1;
+  bool shortest_found = false;
+  int running = engines.size();
+
+  vector<thread> threads;
+  for (int e = 0; e < (int) engines.size(); e++) {
+    threads.emplace_back([&, e] {
+      auto& engine = engines[e];
+      vector<Move> moves;
+      bool solved;
+
+      if (engine.kind == PortfolioEngine::Kind::DFS) {
+        HeuristicMoveOrdering ordering(engine.order_seed);
+        SolveOptions options;
+        options.ordering = engine.heuristic_order ? &ordering : nullptr;
+        options.tablebase = engine.tablebase;
+        options.cancel = &cancel;
+        solved = solve_game_dfs(game, moves, engine.max_depth, options);
+      } else {
+        solved = solve_game_best_first(game, moves, engine.pattern_db, engine.combine, 10000000, &cancel);
+      }
+
+      lock_guard<mutex> lock(result_mutex);
+      if (solved && (best_engine < 0 || moves.size() < best_moves.size())) {
+        best_moves = moves;
+        best_engine = e;
+      }
+      if (solved && finds_shortest(engine))
+        shortest_found = true;
+      running--;
+      result_changed.notify_all();
+    });
+  }
+
+  // wait for the first solution, then for any improvements until the deadline
+  {
+    unique_lock<mutex> lock(result_mutex);
+    result_changed.wait(lock, [&] { return best_engine >= 0 || running == 0; });
+
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double>(improve_seconds);
+    result_changed.wait_until(lock, deadline, [&] { return shortest_found || running == 0; });
+  }
+
+  cancel = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (best_engine < 0)
+    return false;
+
+  moves_to_win.insert(moves_to_win.end(), best_moves.begin(), best_moves.end());
+  if (winning_engine)
+    *winning_engine = best_engine;
+  return true;
+}
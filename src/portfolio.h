@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "pattern_db.h"
+
+class Tablebase;
+
+// One configured solver in a portfolio
+struct PortfolioEngine {
+  enum class Kind { DFS, BEST_FIRST };
+
+  Kind kind = Kind::DFS;
+
+  // depth-first search
+  bool heuristic_order = true;    // order moves with HeuristicMoveOrdering, rather than as they're generated
+  unsigned order_seed = 0;        // seed for breaking ties between moves randomly, or 0 for none
+  int max_depth = 1000;
+  const Tablebase* tablebase = nullptr;
+
+  // best-first search
+  const PatternDatabase* pattern_db = nullptr;
+  PatternDatabase::Combine combine = PatternDatabase::Combine::MAX;
+
+  std::string name() const;
+};
+
+// A mix of engines that covers deals that are easy for depth-first search, and ones that need breadth
+std::vector<PortfolioEngine> default_portfolio(const PatternDatabase* pattern_db, const Tablebase* tablebase);
+
+// Runs each engine on its own thread, and returns the first solution found, cancelling the others.
+// With improve_seconds, the other engines keep running for up to that long after the first solution,
+// and the shortest solution is returned instead.  The index of the engine that found it is stored in winning_engine.
+bool solve_game_portfolio(const GameState& game, std::vector<Move>& moves_to_win, const std::vector<PortfolioEngine>& engines,
+    double improve_seconds = 0, int* winning_engine = nullptr);
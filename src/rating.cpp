@@ -0,0 +1,125 @@
+#include "rating.h"
+#include "move_order.h"
+#include "shortener.h"
+#include "solution_cache.h"
+#include "magic_enum.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using namespace std;
+
+// replays the solution, measuring the choices before each move the player makes
+static void measure_solution(const GameState& start, const vector<Move>& moves_to_win, DealRating& rating) {
+  GameState game = start;
+  vector<Move> moves;
+  int choices = 0;
+  size_t total_moves = 0;
+  int total_slots = 0;
+
+  for (auto i = moves_to_win.rbegin(); i != moves_to_win.rend(); ++i) {
+    if (!i->implicit) {
+      moves.clear();
+      generate_moves(game, moves);
+      total_moves += moves.size();
+      for (int s = 0; s < num_suits; s++) {
+        if (game.slots[s].present() && !game.slots[s].dragon_done())
+          total_slots++;
+      }
+      choices++;
+    }
+    game.make_move(*i);
+  }
+
+  rating.solution_length = moves_to_win.size();
+  if (choices > 0) {
+    rating.branching = (double) total_moves / choices;
+    rating.slot_pressure = (double) total_slots / (choices * num_suits);
+  }
+}
+
+DealRating rate_deal(unsigned seed, const RatingOptions& options) {
+  DealRating rating;
+  rating.seed = seed;
+
+  GameState game = GameState::create_random(seed);
+
+  HeuristicMoveOrdering ordering;
+  SolveStats stats;
+  SolveOptions solve_options;
+  solve_options.ordering = &ordering;
+  solve_options.max_states = options.max_states;
+  solve_options.tablebase = options.tablebase;
+  solve_options.deadline = chrono::steady_clock::now() + options.max_time;
+  solve_options.stats = &stats;
+
+  // always searched afresh:  the states searched for a cached answer depend on the search that stored it
+  auto start = chrono::steady_clock::now();
+  vector<Move> moves_to_win;
+  solve_game_dfs(game, moves_to_win, options.max_depth, solve_options);
+  if (options.cache)
+    store_search(*options.cache, game, moves_to_win, options.max_depth, solve_options, stats,
+      chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start));
+  rating.result = stats.result;
+  rating.states_searched = stats.states_searched;
+  if (rating.result != WinResult::WIN)
+    return rating;
+
+  if (options.shorten)
+    shorten_solution(game, moves_to_win);
+  measure_solution(game, moves_to_win, rating);
+
+  const auto& w = options.weights;
+  rating.difficulty =
+    w.log_states * log10(1.0 + rating.states_searched) +
+    w.branching * rating.branching +
+    w.slot_pressure * rating.slot_pressure +
+    w.solution_length * rating.solution_length;
+  return rating;
+}
+
+vector<DealRating> rate_deals(unsigned first_seed, unsigned last_seed, const RatingOptions& options) {
+  vector<DealRating> ratings;
+  if (last_seed < first_seed)
+    return ratings;
+  ratings.resize((size_t) last_seed - first_seed + 1);
+
+  int num_threads = options.num_threads;
+  if (num_threads <= 0)
+    num_threads = max(1u, thread::hardware_concurrency());
+
+  atomic<size_t> next_deal(0);
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&] {
+      for (size_t i = next_deal++; i < ratings.size(); i = next_deal++) {
+        ratings[i] = rate_deal(first_seed + i, options);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  stable_sort(ratings.begin(), ratings.end(), [] (const DealRating& a, const DealRating& b) {
+    bool a_rated = (a.result == WinResult::WIN);
+    bool b_rated = (b.result == WinResult::WIN);
+    if (a_rated != b_rated) return a_rated;
+    return a_rated && (a.difficulty < b.difficulty);
+  });
+  return ratings;
+}
+
+void write_rating_index(ostream& out, const vector<DealRating>& ratings) {
+  for (const auto& rating : ratings) {
+    if (rating.result == WinResult::WIN) {
+      out << rating.difficulty;
+    } else {
+      out << '-';
+    }
+    out << '\t' << rating.seed << '\t' << magic_enum::enum_name(rating.result) << '\t' << rating.states_searched
+        << '\t' << rating.branching << '\t' << rating.slot_pressure << '\t' << rating.solution_length << '\n';
+  }
+}
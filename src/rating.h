@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "game.h"
+
+class SolutionCache;
+class Tablebase;
+
+// Difficulty ratings of deals, from how hard they were to solve.
+//
+// Each deal is searched depth-first with a budget, and its winning line is shortened and replayed to measure it.
+// The difficulty is a weighted sum of the measures:  the search effort in states searched until the first solution,
+// the moves to choose from at each choice along the solution, how full the free slots are along it, and its length.
+// Deals that weren't won within the budget have no difficulty, and sort after every rated deal.
+struct DealRating {
+  unsigned seed = 0;
+  WinResult result = WinResult::MAX;
+  size_t states_searched = 0;
+  double branching = 0;               // average moves to choose from, before each move that isn't implicit
+  double slot_pressure = 0;           // average fraction of the slots holding a card, before each of the same moves
+  int solution_length = 0;            // moves after shortening, including implicit ones
+  double difficulty = 0;
+};
+
+struct RatingWeights {
+  double log_states = 1.0;            // for each power of 10 of states searched
+  double branching = 0.1;
+  double slot_pressure = 3.0;
+  double solution_length = 0.02;
+};
+
+struct RatingOptions {
+  int max_states = 100000;            // budget for each deal
+  std::chrono::milliseconds max_time = std::chrono::milliseconds(10000);
+  int max_depth = 1000;
+  bool shorten = true;
+  RatingWeights weights;
+  const Tablebase* tablebase = nullptr;
+  SolutionCache* cache = nullptr;     // where the results are stored, if given.  deals are still searched when it has them
+  int num_threads = 0;                // 0 for all cores
+};
+
+DealRating rate_deal(unsigned seed, const RatingOptions& options);
+
+// rates every seed from first_seed to last_seed inclusive, spread across threads, sorted from easiest to hardest
+std::vector<DealRating> rate_deals(unsigned first_seed, unsigned last_seed, const RatingOptions& options);
+
+// The index file has a line for each deal in the order given, with the difficulty, seed, result, states searched,
+// branching, slot pressure and solution length separated by tabs.  Deals without a rating have a difficulty of -.
+void write_rating_index(std::ostream& out, const std::vector<DealRating>& ratings);
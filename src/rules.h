@@ -0,0 +1,32 @@
+#pragma once
+
+// The sizes of a variant of the game.
+//
+// Everything is written against the constants in card.h and game.h, which are taken from the rules chosen when
+// building, so each variant is compiled on its own with every loop over suits, values and piles running to a
+// constant.  Build a variant with e.g. make RULES=FourSuitRules, which gets its own binary and build directory.
+struct StandardRules {
+  static constexpr int num_suits = 3;
+  static constexpr int max_value = 9;
+  static constexpr int num_dragons = 4;
+  static constexpr int num_piles = 8;
+  static constexpr int num_blanks = 1;
+};
+
+struct FourSuitRules : StandardRules {
+  static constexpr int num_suits = 4;
+};
+
+struct TenPileRules : StandardRules {
+  static constexpr int num_piles = 10;
+};
+
+struct NoBlankRules : StandardRules {
+  static constexpr int num_blanks = 0;
+};
+
+#ifndef GAME_RULES
+#define GAME_RULES StandardRules
+#endif
+
+typedef GAME_RULES Rules;
@@ -0,0 +1,170 @@
+#include "session.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static PackedState normalized_pack(const GameState& game) {
+  GameState normalized = game;
+  normalized.normalize();
+  return normalized.pack();
+}
+
+void SolutionTree::add(const GameState& game, const vector<Move>& moves_to_win) {
+  // walk the line backwards from the won state, so each state knows how far it is from the end
+  vector<PackedState> line = {normalized_pack(game)};
+  GameState state = game;
+  for (auto i = moves_to_win.rbegin(); i != moves_to_win.rend(); i++) {
+    state.make_move(*i);
+    line.push_back(normalized_pack(state));
+  }
+
+  for (int i = (int) line.size() - 2; i >= 0; i--) {
+    int distance = line.size() - 1 - i;
+    auto existing = nodes.find(line[i]);
+    if (existing == nodes.end() || existing->second.distance > distance)
+      nodes[line[i]] = Node{line[i+1], distance};
+  }
+}
+
+void SolutionTree::add_loss(const GameState& game) {
+  losses.insert(normalized_pack(game));
+}
+
+int SolutionTree::distance(const GameState& game) const {
+  auto node = nodes.find(normalized_pack(game));
+  return (node == nodes.end()) ? -1 : node->second.distance;
+}
+
+bool SolutionTree::is_loss(const GameState& game) const {
+  return !losses.empty() && losses.count(normalized_pack(game)) > 0;
+}
+
+bool SolutionTree::next_move(const GameState& game, Move& move) const {
+  auto node = nodes.find(normalized_pack(game));
+  return node != nodes.end() && find_move_to(game, GameState::unpack(node->second.next), move);
+}
+
+bool SolutionTree::moves_to_win(const GameState& game, vector<Move>& moves) const {
+  GameState state = game;
+  auto node = nodes.find(normalized_pack(state));
+  if (node == nodes.end())
+    return false;
+
+  while (node != nodes.end()) {
+    Move move(0, 0);
+    if (!find_move_to(state, GameState::unpack(node->second.next), move))
+      return false;
+    moves.push_back(move);
+    state.make_move(move);
+    node = nodes.find(node->second.next);
+  }
+
+  return state.win();
+}
+
+SolveSession::SolveSession(int max_depth, int rejoin_depth, size_t rejoin_states)
+    : max_depth(max_depth), rejoin_depth(rejoin_depth), rejoin_states(rejoin_states) {
+}
+
+// breadth-first search for the nearest state on a known line, taking the shortest line home from the first layer that reaches one
+bool SolveSession::rejoin(const GameState& game, vector<Move>& moves_to_win, size_t& states_searched) const {
+  PackedState start = normalized_pack(game);
+
+  // each state reached, and the state it was reached from
+  unordered_map<PackedState, PackedState, PackedStateHash> parents;
+  vector<PackedState> layer = {start};
+  parents[start] = start;
+
+  PackedState best_state;
+  int best_distance = -1;
+  vector<Move> moves;
+
+  for (int depth = 1; depth <= rejoin_depth && !layer.empty() && best_distance < 0 && parents.size() < rejoin_states; depth++) {
+    vector<PackedState> next_layer;
+    for (auto& packed : layer) {
+      GameState state = GameState::unpack(packed);
+      generate_moves(state, moves);
+
+      for (auto& move : moves) {
+        GameState next_state = state;
+        next_state.make_move(move);
+        next_state.normalize();
+        PackedState next_packed = next_state.pack();
+
+        if (!parents.emplace(next_packed, packed).second)
+          continue;
+
+        int distance = next_state.win() ? 0 : tree.distance(next_state);
+        if (distance >= 0 && (best_distance < 0 || distance < best_distance)) {
+          best_distance = distance;
+          best_state = next_packed;
+        }
+        if (!tree.is_loss(next_state))
+          next_layer.push_back(next_packed);
+      }
+    }
+    layer.swap(next_layer);
+  }
+  states_searched = parents.size();
+
+  if (best_distance < 0)
+    return false;
+
+  // follow the way back from the actual game, then the known line from there
+  vector<PackedState> way_back;
+  for (PackedState packed = best_state; packed != start; packed = parents[packed]) {
+    way_back.push_back(packed);
+  }
+
+  vector<Move> forward_moves;
+  GameState state = game;
+  for (auto i = way_back.rbegin(); i != way_back.rend(); i++) {
+    Move move(0, 0);
+    if (!find_move_to(state, GameState::unpack(*i), move))
+      return false;
+    forward_moves.push_back(move);
+    state.make_move(move);
+  }
+  if (!state.win() && !tree.moves_to_win(state, forward_moves))
+    return false;
+
+  moves_to_win.insert(moves_to_win.end(), forward_moves.rbegin(), forward_moves.rend());
+  return true;
+}
+
+bool SolveSession::solve(const GameState& game, vector<Move>& moves_to_win, const SolveOptions& options) {
+  SolveStats stats;
+  vector<Move> moves;
+  bool result;
+
+  if (game.win()) {
+    result = true;
+  } else if (tree.is_loss(game)) {
+    result = false;
+    stats.result = WinResult::LOSE;
+    stats.loss_proven = true;
+  } else if (tree.moves_to_win(game, moves)) {
+    // still on a known line
+    reverse(moves.begin(), moves.end());
+    result = true;
+  } else if (rejoin(game, moves, stats.states_searched)) {
+    result = true;
+  } else {
+    SolveOptions search_options = options;
+    search_options.solutions = &tree;
+    search_options.stats = &stats;
+    result = solve_game_dfs(game, moves, max_depth, search_options);
+    if (!result && stats.result == WinResult::LOSE && stats.loss_proven)
+      tree.add_loss(game);
+  }
+
+  if (result) {
+    stats.result = WinResult::WIN;
+    tree.add(game, moves);
+    moves_to_win.insert(moves_to_win.end(), moves.begin(), moves.end());
+  }
+  if (options.stats)
+    *options.stats = stats;
+  return result;
+}
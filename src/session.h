@@ -0,0 +1,63 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "game.h"
+
+// Every winning line found so far for one game, as a tree of normalized states each pointing at the next
+// state on its line, along with states proven to be losses.  Lines that pass through the same state share it,
+// keeping whichever is shorter from there.  The depth-first solver can finish along a line as soon as it
+// reaches any state on one, and adds the states it proves are losses.
+class SolutionTree {
+public:
+  // adds every state along the solution, which is in the usual reverse order
+  void add(const GameState& game, const std::vector<Move>& moves_to_win);
+  void add_loss(const GameState& game);
+
+  // number of moves to win along a known line, or -1 if the state isn't on one
+  int distance(const GameState& game) const;
+  bool is_loss(const GameState& game) const;
+
+  // the next move along the known line from the given state
+  bool next_move(const GameState& game, Move& move) const;
+
+  // appends the known line of moves to win from the given state, in the order they're played
+  bool moves_to_win(const GameState& game, std::vector<Move>& moves) const;
+
+  size_t size() const { return nodes.size(); }
+
+private:
+  struct Node {
+    PackedState next;
+    int distance;
+  };
+
+  std::unordered_map<PackedState, Node, PackedStateHash> nodes;
+  std::unordered_set<PackedState, PackedStateHash> losses;
+};
+
+// Solves one game again and again as it's played, from whatever state it's in, reusing what earlier solves learned.
+//
+// Every winning line found and every state proven lost is kept in a solution tree.  A state on a known line is
+// answered at once.  Otherwise, a breadth-first search of up to rejoin_depth moves looks for a way back onto a known
+// line, which is all it takes after most deviations.  Only when that fails does a full depth-first search run,
+// which still finishes as soon as it reaches a known line, and skips every known loss.
+class SolveSession {
+public:
+  SolveSession(int max_depth = 1000, int rejoin_depth = 4, size_t rejoin_states = 20000);
+
+  // options.stats, if given, is filled in whichever way the answer was found.  options.solutions is ignored
+  bool solve(const GameState& game, std::vector<Move>& moves_to_win, const SolveOptions& options = SolveOptions());
+
+  const SolutionTree& solutions() const { return tree; }
+
+private:
+  SolutionTree tree;
+  int max_depth;
+  int rejoin_depth;
+  size_t rejoin_states;
+
+  bool rejoin(const GameState& game, std::vector<Move>& moves_to_win, size_t& states_searched) const;
+};
@@ -0,0 +1,133 @@
+#include "shortener.h"
+
+#include <unordered_map>
+
+using namespace std;
+
+// the normalized states along the line, from the start to the win
+static vector<PackedState> replay_line(const GameState& game, const vector<Move>& moves_to_win) {
+  vector<PackedState> line;
+  GameState state = game;
+
+  GameState normalized = state;
+  normalized.normalize();
+  line.push_back(normalized.pack());
+
+  for (auto i = moves_to_win.rbegin(); i != moves_to_win.rend(); i++) {
+    state.make_move(*i);
+    normalized = state;
+    normalized.normalize();
+    line.push_back(normalized.pack());
+  }
+
+  return line;
+}
+
+// skip straight from each state to just after the last time the line comes back to it
+static void remove_loops(vector<PackedState>& line) {
+  unordered_map<PackedState, int, PackedStateHash> last_index;
+  for (int i = 0; i < (int) line.size(); i++) {
+    last_index[line[i]] = i;
+  }
+
+  vector<PackedState> result;
+  for (int i = 0; i < (int) line.size(); i = last_index[line[i]] + 1) {
+    result.push_back(line[i]);
+  }
+  line.swap(result);
+}
+
+// breadth-first search from each state along the line, replacing the line up to the furthest later state
+// it reaches in fewer moves than the line takes
+static void take_shortcuts(vector<PackedState>& line, int max_depth, size_t max_states) {
+  unordered_map<PackedState, int, PackedStateHash> line_index;
+  for (int i = 0; i < (int) line.size(); i++) {
+    line_index[line[i]] = i;
+  }
+
+  vector<PackedState> result;
+  vector<Move> moves;
+
+  for (int i = 0; i < (int) line.size(); ) {
+    result.push_back(line[i]);
+
+    // each state reached, and the state it was reached from
+    unordered_map<PackedState, PackedState, PackedStateHash> parents;
+    vector<PackedState> layer = {line[i]};
+    parents[line[i]] = line[i];
+
+    int best_index = i + 1;
+    int best_depth = 1;
+    PackedState best_state;
+
+    for (int depth = 1; depth <= max_depth && !layer.empty() && parents.size() < max_states; depth++) {
+      vector<PackedState> next_layer;
+      for (auto& packed : layer) {
+        GameState state = GameState::unpack(packed);
+        generate_moves(state, moves);
+
+        for (auto& move : moves) {
+          GameState next_state = state;
+          next_state.make_move(move);
+          next_state.normalize();
+          PackedState next_packed = next_state.pack();
+
+          if (!parents.emplace(next_packed, packed).second)
+            continue;
+          next_layer.push_back(next_packed);
+
+          // a later state on the line, reached in fewer moves than the line takes to get there
+          auto found = line_index.find(next_packed);
+          if (found != line_index.end() && (found->second - i) - depth > (best_index - i) - best_depth) {
+            best_index = found->second;
+            best_depth = depth;
+            best_state = next_packed;
+          }
+        }
+      }
+      layer.swap(next_layer);
+    }
+
+    // replace the line up to the best state found with the shortcut to it
+    if (best_index - i > best_depth) {
+      vector<PackedState> shortcut;
+      for (PackedState packed = parents[best_state]; packed != line[i]; packed = parents[packed]) {
+        shortcut.push_back(packed);
+      }
+      result.insert(result.end(), shortcut.rbegin(), shortcut.rend());
+    }
+    i = best_index;
+  }
+
+  line.swap(result);
+}
+
+int shorten_solution(const GameState& game, vector<Move>& moves_to_win, int max_depth, size_t max_states) {
+  auto line = replay_line(game, moves_to_win);
+  int original_size = moves_to_win.size();
+
+  // keep going while the line gets shorter, since each shortcut can bring others within reach
+  size_t prev_size = line.size() + 1;
+  while (line.size() < prev_size) {
+    prev_size = line.size();
+    remove_loops(line);
+    take_shortcuts(line, max_depth, max_states);
+  }
+
+  if ((int) line.size() - 1 >= original_size)
+    return 0;
+
+  // find the actual moves to follow the line from the actual game
+  vector<Move> forward_moves;
+  GameState state = game;
+  for (size_t i = 1; i < line.size(); i++) {
+    Move move(0, 0);
+    if (!find_move_to(state, GameState::unpack(line[i]), move))
+      return 0;
+    forward_moves.push_back(move);
+    state.make_move(move);
+  }
+
+  moves_to_win.assign(forward_moves.rbegin(), forward_moves.rend());
+  return original_size - forward_moves.size();
+}
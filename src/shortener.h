@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+
+// Shortens a solution from any solver, by replaying it and finding a shorter line through the same states.
+// Loops are cut out wherever the line comes back to a state it already passed through, and a breadth-first
+// search of up to max_depth moves from each state along the line looks for shortcuts to any later state.
+// The solution is replaced with the shorter one, in the same reverse order, and the number of moves saved is returned.
+int shorten_solution(const GameState& game, std::vector<Move>& moves_to_win, int max_depth = 3, size_t max_states = 20000);
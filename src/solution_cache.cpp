@@ -0,0 +1,461 @@
+#include "solution_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static GameState relabel_suits(const GameState& game, const int perm[]) {
+  GameState result = game;
+
+  auto relabel = [&] (Card& card) {
+    if (card.present() && card.suit() >= 0)
+      card = Card(perm[card.suit()], card.value());
+  };
+
+  for (int p = 0; p < num_piles; p++) {
+    for (int h = 0; h < game.pile_sizes[p]; h++) {
+      relabel(result.piles[p][h]);
+    }
+  }
+  for (int s = 0; s < num_suits; s++) {
+    relabel(result.slots[s]);
+    result.done[perm[s]] = game.done[s];
+  }
+  result.update_piles();
+
+  return result;
+}
+
+PackedState canonical_deal(const GameState& game, int* perm) {
+  int try_perm[num_suits];
+  for (int s = 0; s < num_suits; s++) {
+    try_perm[s] = s;
+  }
+
+  PackedState best;
+  bool first = true;
+  do {
+    GameState relabelled = relabel_suits(game, try_perm);
+    relabelled.normalize();
+    PackedState packed = relabelled.pack();
+    if (first || packed < best) {
+      best = packed;
+      first = false;
+      if (perm)
+        copy(try_perm, try_perm + num_suits, perm);
+    }
+  } while (next_permutation(try_perm, try_perm + num_suits));
+
+  return best;
+}
+
+// replays the moves from the game, and finds the moves that follow the same line from the target,
+// which is the same deal with its suits relabelled by perm, and its piles in any order
+static bool translate_moves(const GameState& game, const vector<Move>& moves_to_win, const int perm[], const GameState& target,
+    vector<Move>& result) {
+  vector<Move> forward_moves;
+  GameState state = game;
+  GameState target_state = target;
+
+  for (auto i = moves_to_win.rbegin(); i != moves_to_win.rend(); i++) {
+    state.make_move(*i);
+    GameState next_target = relabel_suits(state, perm);
+    next_target.normalize();
+
+    Move move(0, 0);
+    if (!find_move_to(target_state, next_target, move))
+      return false;
+    forward_moves.push_back(move);
+    target_state.make_move(move);
+  }
+
+  result.assign(forward_moves.rbegin(), forward_moves.rend());
+  return true;
+}
+
+// the file is a header, then a hash table of slots pointing into the record data that follows it.
+// records are only ever appended, and a slot is pointed at the newer record when an entry is replaced
+struct CacheHeader {
+  char     magic[8];
+  RulesSignature rules;     // which also gives the size of the deal in each record
+  uint64_t capacity;        // number of slots
+  uint64_t count;           // slots in use
+  uint64_t data_size;       // bytes of record data in use
+  uint64_t data_capacity;
+};
+
+struct CacheSlot {
+  uint64_t hash;
+  uint64_t offset;          // one past the record's offset in the data, or 0 for an empty slot
+};
+
+static const char cache_magic[8] = {'S', 'H', 'Z', 'X', 'S', 'C', '0', '3'};
+static const size_t initial_capacity = 1 << 16;
+static const size_t initial_data_capacity = 1 << 22;
+
+// each record is the canonical deal, the result, the stats, the depth limit, then the moves in the order they're played,
+// two bytes each
+static const size_t record_result = packed_state_size;
+static const size_t record_states = record_result + 1;
+static const size_t record_milliseconds = record_states + 8;
+static const size_t record_max_depth = record_milliseconds + 4;
+static const size_t record_num_moves = record_max_depth + 4;
+static const size_t record_moves = record_num_moves + 2;
+
+static size_t file_size_for(size_t capacity, size_t data_capacity) {
+  return sizeof(CacheHeader) + capacity * sizeof(CacheSlot) + data_capacity;
+}
+
+static_assert(num_suits + num_piles < 0xf, "moves are stored with their slot or pile in 4 bits");
+
+static void encode_move(const Move& move, uint8_t* out) {
+  int to = (move.to == move_to_done) ? 0xf : (move.to + num_suits);
+  out[0] = ((move.from + num_suits) << 4) | to;
+  out[1] = move.size | (move.implicit ? 0x80 : 0);
+}
+
+static Move decode_move(const uint8_t* in) {
+  int from = (in[0] >> 4) - num_suits;
+  int to = ((in[0] & 0xf) == 0xf) ? move_to_done : ((in[0] & 0xf) - num_suits);
+  return Move(from, to, in[1] & 0x7f, (in[1] & 0x80) != 0);
+}
+
+SolutionCache::SolutionCache() : mapped(nullptr), mapped_size(0) {
+}
+
+SolutionCache::~SolutionCache() {
+  close();
+}
+
+bool SolutionCache::map_file(int fd, size_t size) {
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    return false;
+  mapped = (uint8_t*) data;
+  mapped_size = size;
+  return true;
+}
+
+bool SolutionCache::open(const string& cache_path) {
+  close();
+  lock_guard<std::mutex> lock(mutex);
+  path = cache_path;
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // start a new cache in an empty file
+  if (st.st_size == 0) {
+    CacheHeader header;
+    memcpy(header.magic, cache_magic, sizeof(header.magic));
+    header.rules = RulesSignature::current();
+    header.capacity = initial_capacity;
+    header.count = 0;
+    header.data_size = 0;
+    header.data_capacity = initial_data_capacity;
+
+    st.st_size = file_size_for(header.capacity, header.data_capacity);
+    if (ftruncate(fd, st.st_size) != 0 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+      ::close(fd);
+      return false;
+    }
+  }
+
+  bool result = (st.st_size >= (off_t) sizeof(CacheHeader)) && map_file(fd, st.st_size);
+  ::close(fd);
+  if (!result)
+    return false;
+
+  auto header = (const CacheHeader*) mapped;
+  if (memcmp(header->magic, cache_magic, sizeof(header->magic)) != 0 || !header->rules.matches_current() ||
+      file_size_for(header->capacity, header->data_capacity) != mapped_size) {
+    munmap(mapped, mapped_size);
+    mapped = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+void SolutionCache::close() {
+  lock_guard<std::mutex> lock(mutex);
+  if (mapped)
+    munmap(mapped, mapped_size);
+  mapped = nullptr;
+  mapped_size = 0;
+}
+
+size_t SolutionCache::size() const {
+  lock_guard<std::mutex> lock(mutex);
+  return mapped ? ((const CacheHeader*) mapped)->count : 0;
+}
+
+const uint8_t* SolutionCache::find_record(const PackedState& canonical, uint64_t hash) const {
+  auto header = (const CacheHeader*) mapped;
+  auto slots = (const CacheSlot*) (mapped + sizeof(CacheHeader));
+  const uint8_t* data = (const uint8_t*) (slots + header->capacity);
+
+  for (size_t i = hash % header->capacity; slots[i].offset != 0; i = (i + 1) % header->capacity) {
+    if (slots[i].hash == hash) {
+      const uint8_t* record = data + slots[i].offset - 1;
+      if (memcmp(record, canonical.data(), packed_state_size) == 0)
+        return record;
+    }
+  }
+  return nullptr;
+}
+
+// rewrite the cache into a bigger file, then swap it in place of the old one
+bool SolutionCache::grow(size_t min_capacity, size_t min_data_capacity) {
+  auto header = (const CacheHeader*) mapped;
+  auto slots = (const CacheSlot*) (mapped + sizeof(CacheHeader));
+  const uint8_t* data = (const uint8_t*) (slots + header->capacity);
+
+  CacheHeader new_header = *header;
+  while (new_header.capacity < min_capacity) {
+    new_header.capacity *= 2;
+  }
+  while (new_header.data_capacity < min_data_capacity) {
+    new_header.data_capacity *= 2;
+  }
+  new_header.data_size = 0;
+
+  string new_path = path + ".tmp";
+  int fd = ::open(new_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+
+  size_t new_size = file_size_for(new_header.capacity, new_header.data_capacity);
+  void* new_data = MAP_FAILED;
+  if (ftruncate(fd, new_size) == 0)
+    new_data = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (new_data == MAP_FAILED) {
+    remove(new_path.c_str());
+    return false;
+  }
+
+  uint8_t* new_mapped = (uint8_t*) new_data;
+  auto new_slots = (CacheSlot*) (new_mapped + sizeof(CacheHeader));
+  uint8_t* new_records = (uint8_t*) (new_slots + new_header.capacity);
+
+  // copy across only the records still in use
+  for (size_t i = 0; i < header->capacity; i++) {
+    if (slots[i].offset == 0)
+      continue;
+
+    const uint8_t* record = data + slots[i].offset - 1;
+    uint16_t num_moves;
+    memcpy(&num_moves, record + record_num_moves, sizeof(num_moves));
+    size_t record_size = record_moves + num_moves * 2;
+
+    size_t j = slots[i].hash % new_header.capacity;
+    while (new_slots[j].offset != 0) {
+      j = (j + 1) % new_header.capacity;
+    }
+    new_slots[j].hash = slots[i].hash;
+    new_slots[j].offset = new_header.data_size + 1;
+
+    memcpy(new_records + new_header.data_size, record, record_size);
+    new_header.data_size += record_size;
+  }
+  memcpy(new_mapped, &new_header, sizeof(new_header));
+
+  munmap(mapped, mapped_size);
+  mapped = new_mapped;
+  mapped_size = new_size;
+  return rename(new_path.c_str(), path.c_str()) == 0;
+}
+
+bool SolutionCache::lookup(const GameState& game, Entry& entry) const {
+  int perm[num_suits];
+  PackedState canonical = canonical_deal(game, perm);
+  uint64_t hash = PackedStateHash()(canonical);
+
+  Entry found;
+  {
+    lock_guard<std::mutex> lock(mutex);
+    if (!mapped)
+      return false;
+
+    const uint8_t* record = find_record(canonical, hash);
+    if (!record)
+      return false;
+
+    uint16_t num_moves;
+    found.result = (Result) record[record_result];
+    memcpy(&found.states_searched, record + record_states, sizeof(found.states_searched));
+    memcpy(&found.milliseconds, record + record_milliseconds, sizeof(found.milliseconds));
+    memcpy(&found.max_depth, record + record_max_depth, sizeof(found.max_depth));
+    memcpy(&num_moves, record + record_num_moves, sizeof(num_moves));
+
+    // stored in the order they're played
+    for (int i = num_moves - 1; i >= 0; i--) {
+      found.moves_to_win.push_back(decode_move(record + record_moves + i * 2));
+    }
+  }
+
+  // the moves are for the canonical deal, so follow the same line back in the actual game
+  int inverse[num_suits];
+  for (int s = 0; s < num_suits; s++) {
+    inverse[perm[s]] = s;
+  }
+  if (!translate_moves(GameState::unpack(canonical), found.moves_to_win, inverse, game, found.moves_to_win))
+    return false;
+
+  entry = found;
+  return true;
+}
+
+bool SolutionCache::store(const GameState& game, const Entry& entry) {
+  int perm[num_suits];
+  PackedState canonical = canonical_deal(game, perm);
+  uint64_t hash = PackedStateHash()(canonical);
+
+  vector<Move> canonical_moves;
+  if (!translate_moves(game, entry.moves_to_win, perm, GameState::unpack(canonical), canonical_moves))
+    return false;
+
+  lock_guard<std::mutex> lock(mutex);
+  if (!mapped)
+    return false;
+
+  // keep an existing solution, unless this one is shorter, and an existing proof that there's none up to a depth,
+  // unless this is a solution or a proof up to a greater depth
+  const uint8_t* existing = find_record(canonical, hash);
+  if (existing && (Result) existing[record_result] == Result::SOLVED) {
+    uint16_t num_moves;
+    memcpy(&num_moves, existing + record_num_moves, sizeof(num_moves));
+    if (entry.result != Result::SOLVED || canonical_moves.size() >= num_moves)
+      return true;
+  } else if (existing && (Result) existing[record_result] == Result::EXHAUSTED) {
+    int32_t max_depth;
+    memcpy(&max_depth, existing + record_max_depth, sizeof(max_depth));
+    if (entry.result == Result::GAVE_UP || (entry.result == Result::EXHAUSTED && entry.max_depth <= max_depth))
+      return true;
+  }
+
+  size_t record_size = record_moves + canonical_moves.size() * 2;
+  auto header = (CacheHeader*) mapped;
+  if ((header->count + 1) * 2 > header->capacity || header->data_size + record_size > header->data_capacity) {
+    if (!grow((header->count + 1) * 4, (header->data_size + record_size) * 2))
+      return false;
+    header = (CacheHeader*) mapped;
+  }
+
+  auto slots = (CacheSlot*) (mapped + sizeof(CacheHeader));
+  uint8_t* data = (uint8_t*) (slots + header->capacity);
+
+  // append the record
+  uint8_t* record = data + header->data_size;
+  uint16_t num_moves = canonical_moves.size();
+  memcpy(record, canonical.data(), packed_state_size);
+  record[record_result] = (uint8_t) entry.result;
+  memcpy(record + record_states, &entry.states_searched, sizeof(entry.states_searched));
+  memcpy(record + record_milliseconds, &entry.milliseconds, sizeof(entry.milliseconds));
+  memcpy(record + record_max_depth, &entry.max_depth, sizeof(entry.max_depth));
+  memcpy(record + record_num_moves, &num_moves, sizeof(num_moves));
+  for (int i = 0; i < num_moves; i++) {
+    encode_move(canonical_moves[num_moves - 1 - i], record + record_moves + i * 2);
+  }
+
+  // point the deal's slot at it, replacing any older record
+  size_t i = hash % header->capacity;
+  while (slots[i].offset != 0 && !(slots[i].hash == hash && memcmp(data + slots[i].offset - 1, canonical.data(), packed_state_size) == 0)) {
+    i = (i + 1) % header->capacity;
+  }
+  if (slots[i].offset == 0)
+    header->count++;
+  slots[i].hash = hash;
+  slots[i].offset = header->data_size + 1;
+  header->data_size += record_size;
+
+  return true;
+}
+
+bool find_cached(const GameState& game, vector<Move>& moves_to_win, int max_depth, const SolveOptions& options,
+    const SolutionCache& cache, bool& solved) {
+  SolutionCache::Entry entry;
+  if (!cache.lookup(game, entry))
+    return false;
+
+  switch (entry.result) {
+  case SolutionCache::Result::SOLVED:
+    if (entry.moves_to_win.size() > (size_t) max_depth)
+      return false;
+    break;
+  case SolutionCache::Result::EXHAUSTED:
+    if (entry.max_depth < max_depth)
+      return false;
+    break;
+  case SolutionCache::Result::GAVE_UP:
+    // a search that gave up before is only worth repeating with higher limits
+    if (entry.max_depth < max_depth || entry.states_searched < (uint64_t) options.max_states)
+      return false;
+    break;
+  }
+
+  solved = (entry.result == SolutionCache::Result::SOLVED);
+  moves_to_win.insert(moves_to_win.end(), entry.moves_to_win.begin(), entry.moves_to_win.end());
+  if (options.stats) {
+    options.stats->result = solved ? WinResult::WIN : (entry.result == SolutionCache::Result::EXHAUSTED) ? WinResult::LOSE : WinResult::MAX;
+    options.stats->loss_proven = false;
+    options.stats->states_searched = entry.states_searched;
+  }
+  return true;
+}
+
+bool store_search(SolutionCache& cache, const GameState& game, const vector<Move>& moves_to_win, int max_depth,
+    const SolveOptions& options, const SolveStats& stats, chrono::milliseconds time) {
+  // results cut short by cancelling don't say anything about the deal
+  if (options.cancel && *options.cancel)
+    return false;
+
+  SolutionCache::Entry entry;
+  entry.result = (stats.result == WinResult::WIN) ? SolutionCache::Result::SOLVED :
+    (stats.result == WinResult::LOSE) ? SolutionCache::Result::EXHAUSTED : SolutionCache::Result::GAVE_UP;
+  entry.moves_to_win = moves_to_win;
+  entry.states_searched = stats.states_searched;
+  entry.milliseconds = time.count();
+  entry.max_depth = max_depth;
+  return cache.store(game, entry);
+}
+
+bool solve_game_cached(const GameState& game, vector<Move>& moves_to_win, int max_depth, const SolveOptions& options,
+    SolutionCache& cache, bool* cache_hit) {
+  bool solved = false;
+  bool found = find_cached(game, moves_to_win, max_depth, options, cache, solved);
+  if (cache_hit)
+    *cache_hit = found;
+  if (found)
+    return solved;
+
+  SolveStats stats;
+  SolveOptions search_options = options;
+  search_options.stats = &stats;
+
+  auto start = chrono::steady_clock::now();
+  vector<Move> moves;
+  bool result = solve_game_dfs(game, moves, max_depth, search_options);
+  store_search(cache, game, moves, max_depth, options, stats, chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start));
+
+  if (options.stats)
+    *options.stats = stats;
+  if (result)
+    moves_to_win.insert(moves_to_win.end(), moves.begin(), moves.end());
+  return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Canonical form of a deal, the same for every deal that only differs by the order of its piles and slots,
+// or by which suit is which.  perm, if given, receives the suit each suit of the game was relabelled as.
+PackedState canonical_deal(const GameState& game, int* perm = nullptr);
+
+// Persistent cache of search results, keyed by the canonical form of each deal, in a memory-mapped file.
+//
+// Moves are stored for the canonical deal, and translated to and from the pile order and suits of the game asked about,
+// so a solution found for one deal also answers every equivalent deal.  The file is shared by all threads of one process,
+// but should only be written by one process at a time.
+class SolutionCache {
+public:
+  enum class Result : uint8_t {
+    SOLVED,      // moves_to_win holds a solution
+    EXHAUSTED,   // every line was searched without a win
+    GAVE_UP,     // the search reached its limits without a win
+  };
+
+  struct Entry {
+    Result result = Result::GAVE_UP;
+    std::vector<Move> moves_to_win;   // in the usual reverse order
+    uint64_t states_searched = 0;
+    uint32_t milliseconds = 0;
+    int32_t max_depth = 0;            // depth limit of the search
+  };
+
+  SolutionCache();
+  ~SolutionCache();
+
+  // opens the cache file, creating it if it doesn't exist yet
+  bool open(const std::string& path);
+  void close();
+  bool is_open() const { return mapped != nullptr; }
+
+  bool lookup(const GameState& game, Entry& entry) const;
+  bool store(const GameState& game, const Entry& entry);
+
+  size_t size() const;
+
+private:
+  std::string path;
+  uint8_t* mapped;
+  size_t mapped_size;
+  mutable std::mutex mutex;
+
+  bool map_file(int fd, size_t size);
+  bool grow(size_t min_capacity, size_t min_data_capacity);
+  const uint8_t* find_record(const PackedState& canonical, uint64_t hash) const;
+
+  SolutionCache(const SolutionCache&) = delete;
+  SolutionCache& operator=(const SolutionCache&) = delete;
+};
+
+// Looks up an answer for an equivalent deal that a search with the given depth limit and options couldn't improve on:
+// a solution no longer than max_depth, or a search that found none with at least these limits.  Returns true if there
+// is one, setting solved, and appending the solution to moves_to_win when there is one.
+bool find_cached(const GameState& game, std::vector<Move>& moves_to_win, int max_depth, const SolveOptions& options,
+    const SolutionCache& cache, bool& solved);
+
+// Stores the result of a depth-first search for the game, as given by its stats, unless the search was cancelled.
+bool store_search(SolutionCache& cache, const GameState& game, const std::vector<Move>& moves_to_win, int max_depth,
+    const SolveOptions& options, const SolveStats& stats, std::chrono::milliseconds time);
+
+// Solves the game with the depth-first solver, unless find_cached has an answer for it.  New results are stored in
+// the cache, and the stats, if requested, come from the cache entry on a hit.  Returns true if moves_to_win holds a solution.
+bool solve_game_cached(const GameState& game, std::vector<Move>& moves_to_win, int max_depth, const SolveOptions& options,
+    SolutionCache& cache, bool* cache_hit = nullptr);
@@ -0,0 +1,209 @@
+#include "solvable_deal.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace std;
+
+// a move that could have been played to reach the state, and the card it brings back into play, if any
+struct Undo {
+  Move move;
+  Card card;
+};
+
+// piles are the same sizes as in a deal from create_random, where the first ones get one more card when they don't divide evenly
+static int dealt_pile_size(int pile) {
+  return max_cards / num_piles + ((pile < max_cards % num_piles) ? 1 : 0);
+}
+
+static GameState won_state() {
+  GameState game;
+  for (int s = 0; s < num_suits; s++) {
+    game.done[s] = max_value;
+    game.slots[s] = Card(s, -num_dragons);
+  }
+  game.blank_done = num_blanks;
+  return game;
+}
+
+static bool pile_has_room(const GameState& game, int pile, int count = 1) {
+  return game.pile_sizes[pile] + count <= dealt_pile_size(pile);
+}
+
+// the moves that bring a card back into the piles or slots, from done, or from a slot back onto a pile
+static void find_returning_undos(const GameState& game, vector<Undo>& undos) {
+  int piles_with_room = 0;
+  int empty_slots = 0;
+  for (int p = 0; p < num_piles; p++) {
+    if (pile_has_room(game, p))
+      piles_with_room++;
+  }
+  for (int s = 0; s < num_suits; s++) {
+    if (!game.slots[s].present())
+      empty_slots++;
+  }
+
+  for (int s = 0; s < num_suits; s++) {
+    auto slot = game.slots[s];
+    if (slot.dragon_done()) {
+      // the dragons go to different piles, or to slots, including the one their stack leaves
+      if (piles_with_room + empty_slots + 1 >= num_dragons)
+        undos.push_back({Move(0, move_to_done, 1, false), Card(s, -1)});
+    } else if (slot.present()) {
+      for (int p = 0; p < num_piles; p++) {
+        if (pile_has_room(game, p))
+          undos.push_back({Move(p, -s-1, 1, false), no_card});
+      }
+    }
+
+    if (game.done[s] > 0) {
+      Card card(s, game.done[s]);
+      for (int p = 0; p < num_piles; p++) {
+        if (pile_has_room(game, p))
+          undos.push_back({Move(p, move_to_done, 1, false), card});
+      }
+      for (int e = 0; e < num_suits; e++) {
+        if (!game.slots[e].present())
+          undos.push_back({Move(-e-1, move_to_done, 1, false), card});
+      }
+    }
+  }
+
+  // a blank card in a slot can't be moved to done, so it only comes back onto a pile
+  if (game.blank_done > 0) {
+    for (int p = 0; p < num_piles; p++) {
+      if (pile_has_room(game, p))
+        undos.push_back({Move(p, move_to_done, 1, false), blank_card});
+    }
+  }
+}
+
+// the moves of cards already in the piles:  from the top of a pile to a slot, or a stack from one pile to another.
+// a card can only be taken back off a pile when it would have been legal to place it there
+static void find_in_play_undos(const GameState& game, vector<Undo>& undos) {
+  for (int to = 0; to < num_piles; to++) {
+    int run = game.run_lengths[to];
+    if (run == 0)
+      continue;
+
+    if (run >= 2 || game.pile_sizes[to] == 1) {
+      for (int s = 0; s < num_suits; s++) {
+        if (!game.slots[s].present())
+          undos.push_back({Move(-s-1, to, 1, false), no_card});
+      }
+    }
+
+    for (int size = 1; size <= run; size++) {
+      if (size == run && size != game.pile_sizes[to])
+        break;
+      for (int from = 0; from < num_piles; from++) {
+        if (from != to && pile_has_room(game, from, size))
+          undos.push_back({Move(from, to, size, false), no_card});
+      }
+    }
+  }
+}
+
+static void undo_dragons(GameState& game, int suit, mt19937& rng, Move& move) {
+  game.slots[suit] = no_card;
+
+  // places are piles, and slots as negative numbers like in moves
+  vector<int> places;
+  for (int p = 0; p < num_piles; p++) {
+    if (pile_has_room(game, p))
+      places.push_back(p);
+  }
+  for (int s = 0; s < num_suits; s++) {
+    if (!game.slots[s].present())
+      places.push_back(-s-1);
+  }
+  shuffle(places.begin(), places.end(), rng);
+
+  Card dragon(suit, -1);
+  for (int i = 0; i < num_dragons; i++) {
+    if (places[i] >= 0) {
+      game.add_cards(places[i], &dragon, 1);
+    } else {
+      game.slots[-places[i]-1] = dragon;
+    }
+  }
+  move = Move(places[0], move_to_done, 1, false);
+}
+
+// takes back the move, putting the state back to how it was before the move was played
+static void undo_move(GameState& game, Undo& undo, mt19937& rng) {
+  auto& move = undo.move;
+  if (move.to == move_to_done) {
+    auto card = undo.card;
+    if (card.dragon()) {
+      undo_dragons(game, card.suit(), rng, move);
+      return;
+    }
+    if (card.blank()) {
+      game.blank_done--;
+    } else {
+      game.done[card.suit()]--;
+    }
+    if (move.from >= 0) {
+      game.add_cards(move.from, &card, 1);
+    } else {
+      game.slots[-move.from-1] = card;
+    }
+  } else if (move.to < 0) {
+    // pile to slot
+    int s = -move.to-1;
+    game.add_cards(move.from, &game.slots[s], 1);
+    game.slots[s] = no_card;
+  } else if (move.from < 0) {
+    // slot to pile
+    game.slots[-move.from-1] = game.top_card_of_pile(move.to);
+    game.remove_cards(move.to, 1);
+  } else {
+    // pile to pile
+    Card stack[max_pile_size];
+    copy_n(&game.piles[move.to][game.pile_sizes[move.to] - move.size], move.size, stack);
+    game.remove_cards(move.to, move.size);
+    game.add_cards(move.from, stack, move.size);
+  }
+}
+
+static bool play_backwards(GameState& game, vector<Move>& moves_to_win, mt19937& rng) {
+  game = won_state();
+  moves_to_win.clear();
+
+  vector<Undo> returning, in_play;
+  int cards_in_piles = 0;
+  for (int step = 0; step < 40 * max_cards; step++) {
+    if (cards_in_piles == max_cards)
+      return true;
+
+    returning.clear();
+    in_play.clear();
+    find_returning_undos(game, returning);
+    find_in_play_undos(game, in_play);
+
+    // a card comes back into play a quarter of the time, and the rest of the time the cards in play are mixed up
+    auto& undos = (in_play.empty() || (!returning.empty() && rng() % 4 == 0)) ? returning : in_play;
+    if (undos.empty())
+      return false;
+    auto& undo = undos[rng() % undos.size()];
+    undo_move(game, undo, rng);
+
+    // moves_to_win is in reverse order, so the moves undone are already in the right order
+    moves_to_win.push_back(undo.move);
+
+    cards_in_piles = 0;
+    for (int p = 0; p < num_piles; p++) {
+      cards_in_piles += game.pile_sizes[p];
+    }
+  }
+  return false;
+}
+
+GameState create_solvable(unsigned seed, vector<Move>& moves_to_win) {
+  mt19937 rng(seed);
+  GameState game;
+  while (!play_backwards(game, moves_to_win, rng)) {
+  }
+  return game;
+}
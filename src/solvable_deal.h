@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+
+// Deals that are known to be solvable, made by playing the game backwards from the won state.
+//
+// Each step undoes a move chosen at random from every move that could have led to the current state:  cards come
+// back off the done piles, dragons come back out of their slot, and cards already in play move between piles and
+// slots.  Piles are never filled past their size in a deal, so once every card is back in the piles, they're laid out
+// like a deal from create_random.  The moves undone, played forwards, are a solution, though a long and roundabout
+// one that's worth shortening.  The same seed always makes the same deal, and it's safe to call from any thread.
+GameState create_solvable(unsigned seed, std::vector<Move>& moves_to_win);
@@ -0,0 +1,351 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// the file is a header followed by the sorted entries.  each entry is the start of the packed normalized state,
+// which is all of it that can be nonzero with so few cards left, followed by one byte of distance to win
+struct TablebaseHeader {
+  char     magic[8];
+  RulesSignature rules;
+  uint32_t max_cards;
+  uint32_t key_size;
+  uint64_t num_entries;
+};
+
+static const char tablebase_magic[8] = {'S', 'H', 'Z', 'X', 'T', 'B', '0', '2'};
+static const uint8_t lose_distance = 0xff;
+
+static int key_size_for(int max_cards) {
+  return max_cards + num_piles + (num_suits * 2) + 1;
+}
+
+int cards_left(const GameState& game) {
+  int count = 0;
+  for (int p = 0; p < num_piles; p++) {
+    count += game.pile_sizes[p];
+  }
+  for (int s = 0; s < num_suits; s++) {
+    if (game.slots[s].present() && !game.slots[s].dragon_done())
+      count++;
+  }
+  return count;
+}
+
+// binary search for the given key in a sorted array of fixed size entries, returning its index or -1
+static ptrdiff_t find_entry(const uint8_t* entries, size_t num_entries, size_t stride, const uint8_t* key, size_t key_size) {
+  size_t lo = 0;
+  size_t hi = num_entries;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int c = memcmp(entries + mid * stride, key, key_size);
+    if (c == 0)
+      return mid;
+    if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return -1;
+}
+
+Tablebase::Tablebase() : table_max_cards(-1), key_size(0), num_entries(0), entries(nullptr), mapped(nullptr), mapped_size(0) {
+}
+
+Tablebase::~Tablebase() {
+  close();
+}
+
+bool Tablebase::open(const string& path) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(TablebaseHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  mapped = data;
+  mapped_size = st.st_size;
+
+  TablebaseHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, tablebase_magic, sizeof(header.magic)) != 0 || !header.rules.matches_current() ||
+      (int) header.key_size != key_size_for(header.max_cards) ||
+      sizeof(header) + header.num_entries * (header.key_size + 1) != mapped_size) {
+    close();
+    return false;
+  }
+
+  table_max_cards = header.max_cards;
+  key_size = header.key_size;
+  num_entries = header.num_entries;
+  entries = (const uint8_t*) data + sizeof(header);
+  return true;
+}
+
+void Tablebase::close() {
+  if (mapped)
+    munmap(mapped, mapped_size);
+  mapped = nullptr;
+  mapped_size = 0;
+  entries = nullptr;
+  num_entries = 0;
+  table_max_cards = -1;
+}
+
+int Tablebase::probe(const GameState& game) const {
+  if (!entries || cards_left(game) > table_max_cards)
+    return not_covered;
+
+  GameState normalized = game;
+  normalized.normalize();
+  auto packed = normalized.pack();
+
+  ptrdiff_t i = find_entry(entries, num_entries, key_size + 1, packed.data(), key_size);
+  if (i < 0)
+    return not_covered;
+
+  uint8_t distance = entries[i * (key_size + 1) + key_size];
+  return (distance == lose_distance) ? lose : distance;
+}
+
+bool Tablebase::moves_to_win(const GameState& game, vector<Move>& moves) const {
+  int distance = probe(game);
+  if (distance < 0)
+    return false;
+
+  // step down through the table, to any next state one move closer to a win
+  GameState state = game;
+  vector<Move> next_moves;
+  while (distance > 0) {
+    generate_moves(state, next_moves);
+
+    bool found = false;
+    for (auto& move : next_moves) {
+      GameState next_state = state;
+      next_state.make_move(move);
+      if (probe(next_state) == distance - 1) {
+        moves.push_back(move);
+        state = next_state;
+        distance--;
+        found = true;
+        break;
+      }
+    }
+    if (!found)
+      return false;
+  }
+
+  return true;
+}
+
+// place each remaining card in turn into a free slot, or anywhere within the piles,
+// and collect the key of each complete arrangement
+static void enumerate_states(GameState& game, const vector<Card>& cards, size_t next, int key_size, vector<uint8_t>& keys) {
+  if (next == cards.size()) {
+    GameState normalized = game;
+    normalized.update_piles();
+    normalized.normalize();
+    auto packed = normalized.pack();
+    keys.insert(keys.end(), packed.begin(), packed.begin() + key_size);
+    return;
+  }
+
+  auto card = cards[next];
+
+  // slots are interchangeable, so only the first free one is needed
+  for (int s = 0; s < num_suits; s++) {
+    if (!game.slots[s].present()) {
+      game.slots[s] = card;
+      enumerate_states(game, cards, next+1, key_size, keys);
+      game.slots[s] = no_card;
+      break;
+    }
+  }
+
+  // piles are filled in order, so stop after the first empty one
+  for (int p = 0; p < num_piles; p++) {
+    int size = game.pile_sizes[p];
+    if (size >= max_pile_size)
+      continue;
+
+    for (int h = size; h >= 0; h--) {
+      for (int i = size; i > h; i--) {
+        game.piles[p][i] = game.piles[p][i-1];
+      }
+      game.piles[p][h] = card;
+      game.pile_sizes[p]++;
+
+      enumerate_states(game, cards, next+1, key_size, keys);
+
+      game.pile_sizes[p]--;
+      for (int i = h; i < size; i++) {
+        game.piles[p][i] = game.piles[p][i+1];
+      }
+      game.piles[p][size] = no_card;
+    }
+
+    if (size == 0)
+      break;
+  }
+}
+
+bool generate_tablebase(const string& path, int max_cards) {
+  if (max_cards < 0 || key_size_for(max_cards) > packed_state_size)
+    return false;
+
+  int key_size = key_size_for(max_cards);
+  vector<uint8_t> keys;
+
+  int done_combinations = 1;
+  for (int s = 0; s < num_suits; s++) {
+    done_combinations *= max_value+1;
+  }
+
+  // every combination of progress on each suit, the dragons, and the blank card, with few enough cards left
+  for (int d = 0; d < done_combinations; d++) {
+    for (int dragons = 0; dragons < (1 << num_suits); dragons++) {
+      for (int blank_done = 0; blank_done <= num_blanks; blank_done++) {
+        GameState game;
+        vector<Card> cards;
+
+        for (int s = 0, rest = d; s < num_suits; s++, rest /= (max_value+1)) {
+          game.done[s] = rest % (max_value+1);
+          for (int v = game.done[s] + 1; v <= max_value; v++) {
+            cards.push_back(Card(s, v));
+          }
+          if (dragons & (1 << s)) {
+            game.slots[s] = Card(s, -num_dragons);
+          } else {
+            for (int i = 0; i < num_dragons; i++) {
+              cards.push_back(Card(s, -1));
+            }
+          }
+        }
+        game.blank_done = blank_done;
+        if (blank_done < num_blanks) {
+          cards.push_back(blank_card);
+        }
+
+        if ((int) cards.size() > max_cards)
+          continue;
+
+        enumerate_states(game, cards, 0, key_size, keys);
+      }
+    }
+  }
+
+  // sort and remove duplicates, which come from identical dragons and from pile orders that normalize the same
+  size_t num_keys = keys.size() / key_size;
+  vector<uint32_t> order(num_keys);
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&] (uint32_t l, uint32_t r) {
+    return memcmp(&keys[l * key_size], &keys[r * key_size], key_size) < 0;
+  });
+
+  const size_t stride = key_size + 1;
+  vector<uint8_t> entries;
+  for (size_t i = 0; i < num_keys; i++) {
+    const uint8_t* key = &keys[order[i] * key_size];
+    if (!entries.empty() && memcmp(&entries[entries.size() - stride], key, key_size) == 0)
+      continue;
+    entries.insert(entries.end(), key, key + key_size);
+    entries.push_back(lose_distance);
+  }
+  keys.clear();
+  keys.shrink_to_fit();
+  order.clear();
+  order.shrink_to_fit();
+
+  size_t num_entries = entries.size() / stride;
+  cout << "tablebase states: " << num_entries << endl;
+
+  // find the successors of every state.  moves never take cards back out of done, so they all stay in the table
+  vector<uint32_t> successor_start(num_entries + 1);
+  vector<uint32_t> successors;
+  vector<Move> moves;
+
+  for (size_t i = 0; i < num_entries; i++) {
+    successor_start[i] = successors.size();
+
+    PackedState packed = {};
+    copy(&entries[i * stride], &entries[i * stride] + key_size, packed.begin());
+    GameState state = GameState::unpack(packed);
+
+    if (state.win()) {
+      entries[i * stride + key_size] = 0;
+      continue;
+    }
+
+    generate_moves(state, moves);
+    for (auto& move : moves) {
+      GameState next_state = state;
+      next_state.make_move(move);
+      next_state.normalize();
+      auto next_packed = next_state.pack();
+
+      ptrdiff_t j = find_entry(entries.data(), num_entries, stride, next_packed.data(), key_size);
+      if (j < 0) {
+        cout << "tablebase is missing a state" << endl;
+        return false;
+      }
+      successors.push_back(j);
+    }
+  }
+  successor_start[num_entries] = successors.size();
+
+  // retrograde solve:  each pass finds the states one move further from a win than the last pass did
+  for (int distance = 1; distance < lose_distance; distance++) {
+    vector<size_t> solved;
+    for (size_t i = 0; i < num_entries; i++) {
+      if (entries[i * stride + key_size] != lose_distance)
+        continue;
+      for (uint32_t k = successor_start[i]; k < successor_start[i+1]; k++) {
+        if (entries[successors[k] * stride + key_size] == distance - 1) {
+          solved.push_back(i);
+          break;
+        }
+      }
+    }
+
+    if (solved.empty())
+      break;
+
+    cout << "distance: " << distance << "  states: " << solved.size() << endl;
+    for (auto i : solved) {
+      entries[i * stride + key_size] = distance;
+    }
+  }
+
+  TablebaseHeader header;
+  memcpy(header.magic, tablebase_magic, sizeof(header.magic));
+  header.rules = RulesSignature::current();
+  header.max_cards = max_cards;
+  header.key_size = key_size;
+  header.num_entries = num_entries;
+
+  ofstream out(path, ios::binary);
+  out.write((const char*) &header, sizeof(header));
+  out.write((const char*) entries.data(), entries.size());
+  return (bool) out;
+}
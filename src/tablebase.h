@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Endgame tablebase, covering every canonical state with only a few cards left outside of done.
+// Each state is stored with its exact distance to a win, or as a loss, so the solvers can stop searching
+// as soon as they reach one.  The table file is generated offline, then memory-mapped when it's used.
+class Tablebase {
+public:
+  static const int lose = -1;           // probe result for a state that can't be won
+  static const int not_covered = -2;    // probe result for a state with too many cards left
+
+  Tablebase();
+  ~Tablebase();
+
+  bool open(const std::string& path);
+  void close();
+
+  bool is_open() const { return entries != nullptr; }
+  int max_cards() const { return table_max_cards; }
+
+  // number of moves to win from the given state, or one of the results above
+  int probe(const GameState& game) const;
+
+  // appends a shortest line of moves to win from the given state, in the order they're played
+  bool moves_to_win(const GameState& game, std::vector<Move>& moves) const;
+
+private:
+  int table_max_cards;
+  int key_size;
+  size_t num_entries;
+  const uint8_t* entries;
+  void* mapped;
+  size_t mapped_size;
+
+  Tablebase(const Tablebase&) = delete;
+  Tablebase& operator=(const Tablebase&) = delete;
+};
+
+// Enumerates every state with at most max_cards cards left outside of done, solves them all backwards
+// from the won state, and writes the table to the given file.
+bool generate_tablebase(const std::string& path, int max_cards);
+
+// Cards not yet moved to done, in the piles or slots
+int cards_left(const GameState& game);
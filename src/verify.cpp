@@ -0,0 +1,307 @@
+#include "verify.h"
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+string deal_to_string(const GameState& game) {
+  string result;
+  for (auto b : game.pack()) {
+    result += hex_digits[b >> 4];
+    result += hex_digits[b & 0xf];
+  }
+  return result;
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// a card byte that unpacks into a card that can be in play:  a normal card, a dragon, a stack of dragons, the blank card or no card
+static bool valid_packed_card(uint8_t b) {
+  int suit = (b >> card_value_bits) - 1;
+  int value = (b & ((1 << card_value_bits) - 1)) - num_dragons;
+  if (suit < 0)
+    return suit == -1 && value == 0;
+  if (suit == 0 && value == 0)
+    return true;    // no card
+  return suit < num_suits && (value == -num_dragons || value == -1 || (value >= 1 && value <= max_value));
+}
+
+// a packed state read from outside can't be trusted, so check that it unpacks into a real layout before using it:
+// every card of one deck is in a pile, a slot or done exactly once
+static bool valid_packed_state(const PackedState& packed) {
+  int counts[num_card_codes] = {};
+  int i = 0;
+  for (int p = 0; p < num_piles; p++) {
+    int h = 0;
+    while (i < packed_state_size && packed[i] != 0xff) {
+      if (++h > max_pile_size || !valid_packed_card(packed[i])) return false;
+      auto card = Card::from_code(packed[i]);
+      if (!card.present() || card.dragon_done()) return false;
+      counts[card.code]++;
+      i++;
+    }
+    if (i >= packed_state_size) return false;
+    i++;
+  }
+  if (i + num_suits * 2 + 1 > packed_state_size) return false;
+
+  int done[num_suits];
+  for (int s = 0; s < num_suits; s++) {
+    if (!valid_packed_card(packed[i + s * 2]) || packed[i + s * 2 + 1] > max_value) return false;
+    auto card = Card::from_code(packed[i + s * 2]);
+    if (card.blank()) return false;   // a blank card can't be played from a slot
+    if (card.present())
+      counts[card.code]++;
+    done[s] = packed[i + s * 2 + 1];
+  }
+  int blank_done = packed[i + num_suits * 2];
+  if (blank_done > num_blanks) return false;
+
+  if (counts[blank_card.code] != num_blanks - blank_done) return false;
+  for (int s = 0; s < num_suits; s++) {
+    // the dragons are all in play, or all together in a slot once they're done
+    int dragons = counts[Card(s, -1).code];
+    int dragons_done = counts[Card(s, -num_dragons).code];
+    if (!((dragons == num_dragons && dragons_done == 0) || (dragons == 0 && dragons_done == 1))) return false;
+    for (int v = 1; v <= max_value; v++) {
+      if (counts[Card(s, v).code] != ((v > done[s]) ? 1 : 0)) return false;
+    }
+  }
+  return true;
+}
+
+bool deal_from_string(const string& text, GameState& game) {
+  if (!text.empty() && text.size() <= 10 && text.find_first_not_of("0123456789") == string::npos) {
+    game = GameState::create_random(stoul(text));
+    return true;
+  }
+
+  if (text.size() != packed_state_size * 2)
+    return false;
+
+  PackedState packed;
+  for (int i = 0; i < packed_state_size; i++) {
+    int high = hex_value(text[i*2]);
+    int low = hex_value(text[i*2+1]);
+    if (high < 0 || low < 0)
+      return false;
+    packed[i] = (high << 4) | low;
+  }
+
+  if (!valid_packed_state(packed))
+    return false;
+  game = GameState::unpack(packed);
+  return true;
+}
+
+static void write_location(ostream& os, int location) {
+  if (location == move_to_done) {
+    os << 'd';
+  } else if (location < 0) {
+    os << 's' << (-location-1);
+  } else {
+    os << location;
+  }
+}
+
+static_assert(num_piles <= 10 && num_suits <= 10, "piles and slots are written as a single digit");
+
+// reads a location at the given position in the text, and advances past it
+static bool read_location(const string& text, size_t& i, int& location) {
+  if (i >= text.size())
+    return false;
+
+  char c = text[i++];
+  if (c == 'd') {
+    location = move_to_done;
+  } else if (c == 's') {
+    int s = (i < text.size()) ? text[i++] - '0' : -1;
+    if (s < 0 || s >= num_suits) return false;
+    location = -s-1;
+  } else {
+    int p = c - '0';
+    if (p < 0 || p >= num_piles) return false;
+    location = p;
+  }
+  return true;
+}
+
+string move_to_string(const Move& move) {
+  ostringstream os;
+  write_location(os, move.from);
+  os << '>';
+  write_location(os, move.to);
+  if (move.size != 1)
+    os << 'x' << move.size;
+  if (move.implicit)
+    os << '!';
+  return os.str();
+}
+
+bool move_from_string(const string& text, Move& move) {
+  size_t i = 0;
+  int from, to;
+  if (!read_location(text, i, from) || from == move_to_done)
+    return false;
+  if (i >= text.size() || text[i++] != '>' || !read_location(text, i, to))
+    return false;
+
+  int size = 1;
+  if (i < text.size() && text[i] == 'x') {
+    i++;
+    size = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9' && size <= max_pile_size) {
+      size = size * 10 + (text[i++] - '0');
+    }
+    if (size < 1 || size > max_pile_size)
+      return false;
+  }
+
+  bool implicit = false;
+  if (i < text.size() && text[i] == '!') {
+    i++;
+    implicit = true;
+  }
+
+  if (i != text.size())
+    return false;
+
+  move = Move(from, to, size, implicit);
+  return true;
+}
+
+string moves_to_string(const vector<Move>& moves_to_win) {
+  string result;
+  for (auto i = moves_to_win.rbegin(); i != moves_to_win.rend(); i++) {
+    if (!result.empty())
+      result += ' ';
+    result += move_to_string(*i);
+  }
+  return result;
+}
+
+bool moves_from_string(const string& text, vector<Move>& moves_to_win) {
+  vector<Move> forward_moves;
+  string token;
+  for (size_t i = 0; i < text.size(); ) {
+    size_t end = text.find(' ', i);
+    if (end == string::npos)
+      end = text.size();
+    if (end > i) {
+      token.assign(text, i, end - i);
+      Move move(0, 0);
+      if (!move_from_string(token, move))
+        return false;
+      forward_moves.push_back(move);
+    }
+    i = end + 1;
+  }
+
+  moves_to_win.assign(forward_moves.rbegin(), forward_moves.rend());
+  return true;
+}
+
+bool verify_solution(const GameState& game, const vector<Move>& moves_to_win, string* error) {
+  GameState state = game;
+  int n = 0;
+
+  for (auto i = moves_to_win.rbegin(); i != moves_to_win.rend(); i++, n++) {
+    auto [legal, try_next_size] = state.check_move(*i);
+    if (!legal) {
+      if (error)
+        *error = "illegal move " + to_string(n+1) + ": " + move_to_string(*i);
+      return false;
+    }
+    state.make_move(*i);
+  }
+
+  if (!state.win()) {
+    if (error)
+      *error = "game not won after " + to_string(n) + " moves";
+    return false;
+  }
+  return true;
+}
+
+// verify a single stored solution line, returning an empty string if it's valid
+static string verify_line(const string& line) {
+  auto tab = line.find('\t');
+  if (tab == string::npos)
+    return "missing tab between deal and moves";
+
+  GameState game;
+  if (!deal_from_string(line.substr(0, tab), game))
+    return "can't read deal";
+
+  vector<Move> moves_to_win;
+  if (!moves_from_string(line.substr(tab+1), moves_to_win))
+    return "can't read moves";
+
+  string error;
+  if (!verify_solution(game, moves_to_win, &error))
+    return error;
+  return "";
+}
+
+size_t verify_solutions(istream& in, ostream& out, int num_threads, size_t* num_verified) {
+  if (num_threads <= 0)
+    num_threads = max(1u, thread::hardware_concurrency());
+
+  // lines are verified a batch at a time, so that any size of input can be streamed through
+  const size_t batch_size = 1 << 16;
+  vector<string> lines;
+  vector<string> errors;
+  size_t line_number = 0;
+  size_t failures = 0;
+  size_t verified = 0;
+
+  while (in) {
+    lines.clear();
+    string line;
+    while (lines.size() < batch_size && getline(in, line)) {
+      lines.push_back(line);
+    }
+    if (lines.empty())
+      break;
+
+    errors.assign(lines.size(), "");
+    atomic<size_t> next_line(0);
+
+    vector<thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&] {
+        for (size_t i = next_line++; i < lines.size(); i = next_line++) {
+          if (!lines[i].empty())
+            errors[i] = verify_line(lines[i]);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+      if (lines[i].empty())
+        continue;
+      verified++;
+      if (!errors[i].empty()) {
+        out << "line " << (line_number + i + 1) << ": " << errors[i] << '\n';
+        failures++;
+      }
+    }
+    line_number += lines.size();
+  }
+
+  if (num_verified)
+    *num_verified = verified;
+  return failures;
+}
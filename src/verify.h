@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Text formats for storing solutions.
+//
+// A deal is either the seed it was dealt from, or the packed game state in hex.
+// Moves are separated by spaces, in the order they're played.  Each is written as from>to, where piles are 0-7,
+// slots are s0-s2 and done is d, followed by xN when moving a stack of N cards, and ! when the move is implicit.
+// A stored solution is a deal and its moves on one line, separated by a tab.
+std::string deal_to_string(const GameState& game);
+bool deal_from_string(const std::string& text, GameState& game);
+
+std::string move_to_string(const Move& move);
+bool move_from_string(const std::string& text, Move& move);
+
+// moves_to_win is in the usual reverse order, while the text is in the order the moves are played
+std::string moves_to_string(const std::vector<Move>& moves_to_win);
+bool moves_from_string(const std::string& text, std::vector<Move>& moves_to_win);
+
+// Checks that each move is legal when it's played, and that the game is won at the end.
+// On failure, the reason is stored in error, if given.
+bool verify_solution(const GameState& game, const std::vector<Move>& moves_to_win, std::string* error = nullptr);
+
+// Verifies every stored solution line read from in, spread across threads, and writes a line to out
+// for each one that fails.  Returns the number of failures.  A thread count of 0 uses all available cores.
+size_t verify_solutions(std::istream& in, std::ostream& out, int num_threads = 0, size_t* num_verified = nullptr);